@@ -0,0 +1,242 @@
+// Generates a synthetic project and times bilt building it
+//
+//   gcc -O2 bench/bilt_bench.c -o bilt_bench
+//   ./bilt_bench --files 10000 --depth 4 --fanout 3 --per-dir 50 --backend ninja --runs 3
+//
+// Every run does a clean build, a no-op rebuild and a rebuild after editing one source, each one in a fresh
+// process so bilt starts from nothing like it does for users. The results go to `--output` as JSON.
+#define BILT_IMPLEMENTATION
+#include "../bilt.h"
+
+typedef struct {
+  i32 files;
+  i32 depth;   // NOTE: Levels of headers below each source
+  i32 fanout;  // NOTE: Headers every header (and source) includes from the next level
+  i32 perDir;  // NOTE: Sources per directory, directories nest two levels deep
+  i32 runs;
+  char *backend;
+  char *directory;
+  char *output;
+} BenchOptions;
+
+typedef struct {
+  char *name;
+  i64 wall[64];
+  i64 graph[64];
+} Scenario;
+
+static void writeProjectFile(String path, String content) {
+  if (FileWrite(&path, &content) != SUCCESS) {
+    LogError("Couldn't write %s", path.data);
+    abort();
+  }
+  StrFree(path);
+  StrFree(content);
+}
+
+static String includesOf(BenchOptions *options, i32 level) {
+  String result = S("");
+  for (i32 i = 0; i < options->fanout; i++) {
+    result = FormatMalloc("%s#include \"h%d_%d.h\"\n", result.data, level, i);
+  }
+  return result;
+}
+
+static String sourcePath(BenchOptions *options, i32 index) {
+  i32 group = index / options->perDir;
+  return FormatMalloc("%s/src/g%d/d%d/s%d.c", options->directory, group / options->perDir, group % options->perDir, index);
+}
+
+static void generateProject(BenchOptions *options) {
+  Mkdir(s(options->directory));
+  Mkdir(FormatMalloc("%s/include", options->directory));
+  Mkdir(FormatMalloc("%s/src", options->directory));
+
+  // NOTE: Every header of a level includes all headers of the next one, the guards keep the parse cost linear
+  for (i32 level = 0; level < options->depth; level++) {
+    String nested = level + 1 < options->depth ? includesOf(options, level + 1) : S("");
+    for (i32 i = 0; i < options->fanout; i++) {
+      writeProjectFile(FormatMalloc("%s/include/h%d_%d.h", options->directory, level, i),
+                       FormatMalloc("#ifndef H%d_%d\n#define H%d_%d\n%s\n"
+                                    "typedef struct { int values[%d]; } Type%d_%d;\n"
+                                    "static inline int inline%d_%d(Type%d_%d *t) { return t->values[0] + %d; }\n"
+                                    "#endif\n",
+                                    level, i, level, i, nested.data, i + 1, level, i, level, i, level, i, level));
+    }
+  }
+
+  String includes = options->depth > 0 ? includesOf(options, 0) : S("");
+  for (i32 i = 0; i < options->files; i++) {
+    i32 group = i / options->perDir;
+    if (i % options->perDir == 0) {
+      Mkdir(FormatMalloc("%s/src/g%d", options->directory, group / options->perDir));
+      Mkdir(FormatMalloc("%s/src/g%d/d%d", options->directory, group / options->perDir, group % options->perDir));
+    }
+
+    String path = sourcePath(options, i);
+    String body = i == 0 ? S("int main(void) { return 0; }\n") : FormatMalloc("int function%d(int x) { return x * %d; }\n", i, i);
+    writeProjectFile(path, FormatMalloc("%s\n%s", includes.data, body.data));
+  }
+}
+
+// NOTE: Runs in the child, the parent only sees the wall time otherwise
+static i32 buildProject(char *directory, char *backend, char *report) {
+  SetCwd(s(directory));
+  CreateConfig((BiltOptions){.backend = backend});
+  StartBuild();
+  {
+    CreateExecutable((ExecutableOptions){.output = "bench"});
+    AddDirectory("./src");
+    AddIncludePaths("include");
+    InstallExecutable();
+  }
+  EndBuild();
+
+  FILE *file = fopen(report, "w");
+  if (file == NULL) {
+    return 1;
+  }
+  fprintf(file, "%lld\n", (long long)state.graphTime);
+  fclose(file);
+  return 0;
+}
+
+static void runScenario(BenchOptions *options, Scenario *scenario, i32 run, String self) {
+  String cwd = GetCwd();
+  String report = FormatMalloc("%s/%s/report.txt", cwd.data, options->directory);
+  String log = FormatMalloc("%s/%s/build.log", cwd.data, options->directory);
+  String command = FormatMalloc("%s --build %s/%s %s %s > %s 2>&1", self.data, cwd.data, options->directory, options->backend, report.data, log.data);
+
+  i64 start = TimeNow();
+  if (RunCommand(command) != SUCCESS) {
+    LogError("%s build failed, see %s", scenario->name, log.data);
+    abort();
+  }
+  scenario->wall[run] = TimeNow() - start;
+
+  String content = {0};
+  FileRead(&report, &content);
+  scenario->graph[run] = StrIsNull(&content) ? -1 : strtoll(content.data, NULL, 10);
+  LogInfo("%-6s run %d: %lldms, graph %lldms", scenario->name, run + 1, (long long)scenario->wall[run], (long long)scenario->graph[run]);
+}
+
+static i32 compareTimes(const void *a, const void *b) {
+  i64 first = *(i64 *)a;
+  i64 second = *(i64 *)b;
+  return (first > second) - (first < second);
+}
+
+static i64 median(i64 *values, i32 count) {
+  i64 sorted[64];
+  memcpy(sorted, values, sizeof(i64) * count);
+  qsort(sorted, count, sizeof(i64), compareTimes);
+  return sorted[count / 2];
+}
+
+static void writeResults(BenchOptions *options, Scenario *scenarios, size_t count) {
+  FILE *file = fopen(options->output, "w");
+  if (file == NULL) {
+    LogError("Failed to open output file '%s'", options->output);
+    abort();
+  }
+
+  fprintf(file, "{\n  \"files\": %d,\n  \"depth\": %d,\n  \"fanout\": %d,\n  \"perDir\": %d,\n  \"backend\": \"%s\",\n  \"runs\": %d,\n  \"scenarios\": {\n",
+          options->files, options->depth, options->fanout, options->perDir, options->backend, options->runs);
+  for (size_t i = 0; i < count; i++) {
+    Scenario *scenario = &scenarios[i];
+    fprintf(file, "    \"%s\": {\"wallMs\": %lld, \"graphMs\": %lld, \"wallRunsMs\": [", scenario->name,
+            (long long)median(scenario->wall, options->runs), (long long)median(scenario->graph, options->runs));
+    for (i32 run = 0; run < options->runs; run++) {
+      fprintf(file, "%s%lld", run == 0 ? "" : ", ", (long long)scenario->wall[run]);
+    }
+    fprintf(file, "]}%s\n", i + 1 == count ? "" : ",");
+  }
+  fprintf(file, "  }\n}\n");
+  fclose(file);
+  LogSuccess("Results written to %s", options->output);
+}
+
+static BenchOptions parseBenchOptions(i32 argc, char **argv) {
+  BenchOptions options = {
+      .files = 1000,
+      .depth = 3,
+      .fanout = 3,
+      .perDir = 50,
+      .runs = 3,
+      .backend = "native",
+      .directory = "bench-project",
+      .output = "bilt_bench.json",
+  };
+
+  for (i32 i = 1; i + 1 < argc; i += 2) {
+    char *value = argv[i + 1];
+    if (strcmp(argv[i], "--files") == 0) {
+      options.files = atoi(value);
+    } else if (strcmp(argv[i], "--depth") == 0) {
+      options.depth = atoi(value);
+    } else if (strcmp(argv[i], "--fanout") == 0) {
+      options.fanout = atoi(value);
+    } else if (strcmp(argv[i], "--per-dir") == 0) {
+      options.perDir = atoi(value);
+    } else if (strcmp(argv[i], "--runs") == 0) {
+      options.runs = atoi(value);
+    } else if (strcmp(argv[i], "--backend") == 0) {
+      options.backend = value;
+    } else if (strcmp(argv[i], "--directory") == 0) {
+      options.directory = value;
+    } else if (strcmp(argv[i], "--output") == 0) {
+      options.output = value;
+    } else {
+      LogError("Unknown option %s", argv[i]);
+      abort();
+    }
+  }
+
+  if (options.files < 1 || options.perDir < 1 || options.fanout < 1 || options.runs < 1 || options.runs > 64) {
+    LogError("--files, --per-dir and --fanout must be positive and --runs between 1 and 64");
+    abort();
+  }
+  return options;
+}
+
+i32 main(i32 argc, char **argv) {
+  if (argc == 5 && strcmp(argv[1], "--build") == 0) {
+    return buildProject(argv[2], argv[3], argv[4]);
+  }
+
+  LogInit();
+  BenchOptions options = parseBenchOptions(argc, argv);
+  String self = s(argv[0]);
+
+  i64 start = TimeNow();
+#ifdef PLATFORM_WIN
+  RunCommand(FormatMalloc("if exist %s rmdir /s /q %s", options.directory, options.directory));
+#else
+  RunCommand(FormatMalloc("rm -rf %s", options.directory));
+#endif
+  generateProject(&options);
+  LogInfo("Generated %d sources in %lldms", options.files, (long long)(TimeNow() - start));
+
+  Scenario scenarios[] = {{.name = "clean"}, {.name = "noop"}, {.name = "edit"}};
+  String buildDirectory = FormatMalloc("%s/build", options.directory);
+  String edited = sourcePath(&options, options.files / 2);
+  for (i32 run = 0; run < options.runs; run++) {
+#ifdef PLATFORM_WIN
+    RunCommand(FormatMalloc("if exist %s rmdir /s /q %s", buildDirectory.data, buildDirectory.data));
+#else
+    RunCommand(FormatMalloc("rm -rf %s", buildDirectory.data));
+#endif
+    runScenario(&options, &scenarios[0], run, self);
+    runScenario(&options, &scenarios[1], run, self);
+
+    // NOTE: A real edit, a touch alone would leave the content the same
+    String content = {0};
+    FileRead(&edited, &content);
+    String appended = FormatMalloc("%s// edit %d\n", content.data, run);
+    FileWrite(&edited, &appended);
+    runScenario(&options, &scenarios[2], run, self);
+  }
+
+  writeResults(&options, scenarios, sizeof(scenarios) / sizeof(scenarios[0]));
+  return 0;
+}
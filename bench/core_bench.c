@@ -0,0 +1,289 @@
+// Microbenchmarks of the core/ primitives the driver runs for every source file
+//
+//   gcc -O2 bench/core_bench.c -o core_bench
+//   ./core_bench --filter Str --output core_bench.json
+#define BASE_IMPLEMENTATION
+#include "../core/base.h"
+#include "../core/bench.h"
+#include "../core/hashset.h"
+#include "../core/hashmap.h"
+
+#define KEY_COUNT 1024
+
+HASHMAP_TYPE(IndexMap, String, u64, HashStringKey, StrEqual)
+
+typedef struct {
+  String keys[KEY_COUNT];
+  String misses[KEY_COUNT];
+  String interned[KEY_COUNT];
+  HashSet *set;
+  IndexMap map;
+  String depfile;
+  String path;
+  String directory;
+} BenchData;
+
+static void benchHashSetInsert(void *context, i64 iterations) {
+  BenchData *data = context;
+  for (i64 i = 0; i < iterations; i++) {
+    HashSet *set = HashSetNew(100);
+    for (size_t j = 0; j < KEY_COUNT; j++) {
+      HashSetInsert(set, data->keys[j]);
+    }
+    BenchKeep(set);
+    // NOTE: HashSetFree would free the keys too
+    free(set->entries);
+    free(set->control);
+    free(set);
+  }
+}
+
+static void benchHashSetContains(void *context, i64 iterations) {
+  BenchData *data = context;
+  for (i64 i = 0; i < iterations; i++) {
+    bool found = HashSetContains(data->set, data->keys[i % KEY_COUNT]);
+    BenchKeep(&found);
+  }
+}
+
+static void benchHashSetContainsMiss(void *context, i64 iterations) {
+  BenchData *data = context;
+  for (i64 i = 0; i < iterations; i++) {
+    bool found = HashSetContains(data->set, data->misses[i % KEY_COUNT]);
+    BenchKeep(&found);
+  }
+}
+
+static void benchHashMapFind(void *context, i64 iterations) {
+  BenchData *data = context;
+  for (i64 i = 0; i < iterations; i++) {
+    u64 *index = IndexMapFind(&data->map, data->misses[i % KEY_COUNT]);
+    BenchKeep(index);
+    index = IndexMapFind(&data->map, data->keys[i % KEY_COUNT]);
+    BenchKeep(index);
+  }
+}
+
+static void benchStrSplit(void *context, i64 iterations) {
+  BenchData *data = context;
+  String separator = S(" ");
+  for (i64 i = 0; i < iterations; i++) {
+    StringVector parts = StrSplit(&data->depfile, &separator);
+    BenchKeep(parts.data);
+    for (size_t j = 0; j < parts.length; j++) {
+      StrFree(*VecAt(parts, j));
+    }
+    VecFree(parts);
+  }
+}
+
+static void benchStrSplitView(void *context, i64 iterations) {
+  BenchData *data = context;
+  String separator = S(" ");
+  for (i64 i = 0; i < iterations; i++) {
+    StringVector parts = StrSplitView(&data->depfile, &separator);
+    BenchKeep(parts.data);
+    VecFree(parts);
+  }
+}
+
+// NOTE: The same split with the vector kernels turned off, to see what the dispatch buys on this machine
+static void benchStrSplitScalar(void *context, i64 iterations) {
+  StrScanUseLevel(STRSCAN_SCALAR);
+  benchStrSplitView(context, iterations);
+  StrScanUseLevel(STRSCAN_AVX2_LEVEL); // NOTE: Capped to what the CPU has
+}
+
+static void benchStrConcat(void *context, i64 iterations) {
+  BenchData *data = context;
+  for (i64 i = 0; i < iterations; i++) {
+    String result = StrConcat(&data->path, &data->keys[i % KEY_COUNT]);
+    BenchKeep(result.data);
+    StrFree(result);
+  }
+}
+
+static void benchFormatMalloc(void *context, i64 iterations) {
+  BenchData *data = context;
+  for (i64 i = 0; i < iterations; i++) {
+    String result = FormatMalloc("%s/%s.o", data->path.data, data->keys[i % KEY_COUNT].data);
+    BenchKeep(result.data);
+    StrFree(result);
+  }
+}
+
+static void benchFormatArena(void *context, i64 iterations) {
+  BenchData *data = context;
+  Arena arena = {0};
+  StrSetArena(&arena);
+  ArenaMark mark = ArenaGetMark(&arena);
+  for (i64 i = 0; i < iterations; i++) {
+    String result = FormatMalloc("%s/%s.o", data->path.data, data->keys[i % KEY_COUNT].data);
+    BenchKeep(result.data);
+    if (i % KEY_COUNT == KEY_COUNT - 1) {
+      ArenaReset(&arena, mark);
+    }
+  }
+  StrSetArena(NULL);
+  ArenaFree(&arena);
+}
+
+static void benchStrBuilderAppend(void *context, i64 iterations) {
+  BenchData *data = context;
+  for (i64 i = 0; i < iterations; i++) {
+    StrBuilder builder = StrBuilderNew(64);
+    for (size_t j = 0; j < KEY_COUNT; j++) {
+      StrBuilderAppendFormat(&builder, " %s", data->keys[j].data);
+    }
+    BenchKeep(builder.data);
+    StrBuilderFree(&builder);
+  }
+}
+
+static void benchStrIntern(void *context, i64 iterations) {
+  BenchData *data = context;
+  for (i64 i = 0; i < iterations; i++) {
+    String result = StrIntern(data->keys[i % KEY_COUNT]);
+    BenchKeep(result.data);
+  }
+}
+
+static void benchStrEqualInterned(void *context, i64 iterations) {
+  BenchData *data = context;
+  for (i64 i = 0; i < iterations; i++) {
+    String key = data->interned[i % KEY_COUNT];
+    bool equal = StrEqual(key, data->interned[(i + 1) % KEY_COUNT]) || StrEqual(key, key);
+    BenchKeep(&equal);
+  }
+}
+
+static void benchConvertPath(void *context, i64 iterations) {
+  BenchData *data = context;
+  for (i64 i = 0; i < iterations; i++) {
+    String result = ConvertPath(StrViewOf(data->keys[i % KEY_COUNT]));
+    BenchKeep(result.data);
+    StrFree(result);
+  }
+}
+
+static void benchConvertExe(void *context, i64 iterations) {
+  BenchData *data = context;
+  for (i64 i = 0; i < iterations; i++) {
+    String result = ConvertExe(StrViewOf(data->keys[i % KEY_COUNT]));
+    BenchKeep(result.data);
+    StrFree(result);
+  }
+}
+
+static void benchGetDirFiles(void *context, i64 iterations) {
+  BenchData *data = context;
+  for (i64 i = 0; i < iterations; i++) {
+    Folder *folder = GetDirFiles(data->directory);
+    BenchKeep(folder);
+    FreeFolder(folder);
+  }
+}
+
+static void benchVecPush(void *context, i64 iterations) {
+  BenchData *data = context;
+  for (i64 i = 0; i < iterations; i++) {
+    StringVector vector = {0};
+    for (size_t j = 0; j < KEY_COUNT; j++) {
+      VecPush(vector, data->keys[j]);
+    }
+    BenchKeep(vector.data);
+    VecFree(vector);
+  }
+}
+
+static struct {
+  char *name;
+  BenchFunction function;
+} benchmarks[] = {
+    {"HashSetInsert/1024", benchHashSetInsert},
+    {"HashSetContains/hit", benchHashSetContains},
+    {"HashSetContains/miss", benchHashSetContainsMiss},
+    {"HashMapFind/hit+miss", benchHashMapFind},
+    {"StrSplit/depfile", benchStrSplit},
+    {"StrSplitView/depfile", benchStrSplitView},
+    {"StrSplitView/depfile/scalar", benchStrSplitScalar},
+    {"StrConcat", benchStrConcat},
+    {"FormatMalloc", benchFormatMalloc},
+    {"FormatMalloc/arena", benchFormatArena},
+    {"StrBuilderAppend/1024", benchStrBuilderAppend},
+    {"StrIntern/hit", benchStrIntern},
+    {"StrEqual/interned", benchStrEqualInterned},
+    {"ConvertPath", benchConvertPath},
+    {"ConvertExe", benchConvertExe},
+    {"GetDirFiles", benchGetDirFiles},
+    {"VecPush/1024", benchVecPush},
+};
+
+// NOTE: Inputs shaped like what the driver sees, source paths a few directories deep and a depfile listing headers
+static BenchData *prepareBenchData(char *directory) {
+  BenchData *data = malloc(sizeof(BenchData));
+  String depfile = S("build/0a1b2c3d/main.o:");
+  for (size_t i = 0; i < KEY_COUNT; i++) {
+    data->keys[i] = FormatMalloc("./src/module%zu/component%zu/source_file_%zu.c", i % 16, i % 64, i);
+    data->misses[i] = FormatMalloc("./src/module%zu/component%zu/other_file_%zu.c", i % 16, i % 64, i);
+    data->interned[i] = StrIntern(data->keys[i]);
+    if (i < 64) {
+      depfile = FormatMalloc("%s /usr/include/library/header_%zu.h", depfile.data, i);
+    }
+  }
+
+  data->set = HashSetNew(100);
+  for (size_t i = 0; i < KEY_COUNT; i++) {
+    HashSetInsert(data->set, data->keys[i]);
+  }
+  data->map = (IndexMap){0};
+  for (size_t i = 0; i < KEY_COUNT; i++) {
+    IndexMapInsert(&data->map, data->keys[i], i);
+  }
+  data->depfile = depfile;
+  data->path = S("/home/user/project/build/0a1b2c3d/");
+  data->directory = s(directory);
+  return data;
+}
+
+i32 main(i32 argc, char **argv) {
+  LogInit();
+  char *filter = NULL;
+  char *output = NULL;
+  char *directory = "core";
+  BenchOptions options = {0};
+  for (i32 i = 1; i + 1 < argc; i += 2) {
+    if (strcmp(argv[i], "--filter") == 0) {
+      filter = argv[i + 1];
+    } else if (strcmp(argv[i], "--output") == 0) {
+      output = argv[i + 1];
+    } else if (strcmp(argv[i], "--directory") == 0) {
+      directory = argv[i + 1]; // NOTE: What GetDirFiles walks
+    } else if (strcmp(argv[i], "--repetitions") == 0) {
+      options.repetitions = atoi(argv[i + 1]);
+    } else {
+      LogError("Unknown option %s", argv[i]);
+      abort();
+    }
+  }
+
+  BenchData *data = prepareBenchData(directory);
+  BenchResultVector results = {0};
+  for (size_t i = 0; i < sizeof(benchmarks) / sizeof(benchmarks[0]); i++) {
+    if (filter != NULL && strstr(benchmarks[i].name, filter) == NULL) {
+      continue;
+    }
+    VecPush(results, BenchRun(benchmarks[i].name, benchmarks[i].function, data, options));
+  }
+
+  if (results.length == 0) {
+    LogError("No benchmark matches %s", filter);
+    return 1;
+  }
+
+  BenchPrint(&results);
+  if (output != NULL && BenchWriteJson(&results, output) != SUCCESS) {
+    return 1;
+  }
+  return 0;
+}
@@ -6,18 +6,33 @@
 
 #include "core/base.h"
 #include "core/hashset.h"
+#include "core/hashmap.h"
 
 typedef struct {
   i64 lastBuild;
   bool firstBuild;
+  u64 profileHash; // NOTE: Training command and compiler the PGO profile was recorded with
 } BiltCache;
 
+typedef enum {
+  BACKEND_AUTO, // NOTE: ninja when it's on the PATH, native otherwise
+  BACKEND_NINJA,
+  BACKEND_NATIVE,
+} BiltBackend;
+
 typedef struct {
   char *compiler;
   char *buildDirectory;
   char *source;
   char *exe;
   char *cachePath;
+  char *backend; // "ninja" or "native"
+  i32 jobs;
+  char *compileCache;   // NOTE: Directory of the shared object cache, disabled when NULL
+  i64 compileCacheSize; // NOTE: Bytes, defaults to 5GB
+  char *workers;        // NOTE: Comma separated "unix:/path" or "tcp:host:port" of `bilt --worker` daemons
+  char *profileTraining; // NOTE: Enables PGO, the command runs against the instrumented build, "$exe" is its path
+  bool timeTrace;        // NOTE: Compiles with clang's -ftime-trace and sums it up in time_trace.txt
 } BiltOptions;
 
 typedef struct {
@@ -32,13 +47,33 @@ typedef struct {
   // Cache
   BiltCache cache;
 
+  // Backend
+  BiltBackend backend;
+  i32 jobs;
+  String compileCache;
+  i64 compileCacheSize;
+  StringVector workerAddresses;
+  String profileTraining;
+  bool timeTrace;
+
   // Misc
   bool customConfig;
   i64 startTime;
+  i64 graphTime; // NOTE: From StartBuild until the jobs (or build.ninja) are ready
   i64 totalTime;
 } BiltConfig;
 
+typedef enum {
+  TARGET_EXECUTABLE,
+  TARGET_STATIC_LIBRARY, // NOTE: Thin archive, references the objects instead of copying them
+  TARGET_SHARED_LIBRARY,
+} TargetKind;
+
+#define TARGET_NOT_ADDED SIZE_MAX
+
 typedef struct {
+  TargetKind kind;
+  String name;
   String output;
   String flags;
   String linkerFlags;
@@ -48,21 +83,86 @@ typedef struct {
   // TODO: debugSymbols
   String includes;
   String libs;
+  String precompiledHeader; // NOTE: A header path or "auto"
+  i32 unityBatch;
+  String lto; // NOTE: "full", "thin" or null
+  i32 ltoJobs;
+  bool splitDwarf;
+  StringVector exports;
+  String exportsFile; // NOTE: Version script (or .def on windows) generated from `exports`
   StringVector sources;
   HashSet *fileSet;
+
+  // Graph
+  size_t index;              // NOTE: Position in `targets`, TARGET_NOT_ADDED until it's added
+  String path;
+  StringVector dependencies; // NOTE: Names of the libraries it links against
+  StringVector objects;
+  String pchInclude;
+  String pchOutput;
 } Executable;
 
+VEC_TYPE(TargetVector, Executable);
+
+typedef struct {
+  String output;
+  String command;
+  StringVector inputs;
+  String depfile; // NOTE: Extra inputs written by the compiler, may be null
+  String cacheEntry; // NOTE: Compile cache entry the output should be stored under
+  String preprocessCommand; // NOTE: Writes `<output>.i`, used for cache keys and workers
+  String remoteFlags; // NOTE: Flags to compile the preprocessed source with, null keeps the job local
+  String objectFlags; // NOTE: Flags only this object is compiled with
+  String splitDebug;  // NOTE: .dwo the compiler writes next to the object, null without split DWARF
+  size_t target;      // NOTE: Target whose flags the job uses
+  char *kind;         // NOTE: "pch", "compile", "link" or "preprocess", the category in the trace
+  bool succeeded;
+} BuildJob;
+
+VEC_TYPE(BuildJobVector, BuildJob);
+
+typedef struct {
+  String address;
+  i32 slots;
+  i32 running;
+} Worker;
+
+VEC_TYPE(WorkerVector, Worker);
+
+typedef struct {
+  String output;
+  char *kind;
+  String lane;     // NOTE: "local", "ninja" or the worker address
+  i64 start;       // NOTE: Milliseconds since the build started
+  i64 end;
+  i64 cpuTime;     // NOTE: Microseconds, -1 when unknown
+  i64 peakMemory;  // NOTE: Kilobytes, -1 when unknown
+} TraceSpan;
+
+VEC_TYPE(TraceSpanVector, TraceSpan);
+
 typedef struct {
   char *output;
   char *flags;
   char *linkerFlags;
   char *includes;
   char *libs;
+  char *precompiledHeader; // NOTE: "auto" precompiles the headers most sources include
+  i32 unityBatch;          // NOTE: Sources per generated unity file, 0 compiles them one by one
+  char *exports;           // NOTE: Space separated symbols a shared library exports
+  char *lto;               // NOTE: "full" or "thin", gcc has no ThinLTO and uses its parallel full LTO instead
+  i32 ltoJobs;             // NOTE: Parallel LTO code generation jobs at link time, defaults to `BiltOptions.jobs`
+  char *linker;            // NOTE: "mold", "lld", "gold", "bfd" or "auto" for the fastest one installed, null keeps the compiler's default
+  bool splitDwarf;         // NOTE: Debug info goes to a .dwo next to each object and the linker never copies it, use with -g
+  bool gdbIndex;           // NOTE: The linker writes a .gdb_index so gdb starts faster, needs gold, lld or mold
+  bool compressDebug;      // NOTE: zlib compressed debug sections in objects and outputs
 } ExecutableOptions;
 
 void CreateConfig(BiltOptions options);
 void StartBuild();
 void CreateExecutable(ExecutableOptions executableOptions);
+void CreateStaticLibrary(ExecutableOptions executableOptions);
+void CreateSharedLibrary(ExecutableOptions executableOptions);
 
 static void addLibraryPaths(StringVector *vector);
 #define AddLibraryPaths(...)                                                                                                                                                                                                                   \
@@ -88,49 +188,139 @@ static void linkSystemLibraries(StringVector *vector);
     linkSystemLibraries(&vector);                                                                                                                                                                                                              \
   })
 
+static void linkTargets(StringVector *vector);
+#define LinkTargets(...)                                                                                                                                                                                                                       \
+  ({                                                                                                                                                                                                                                           \
+    StringVector vector = {0};                                                                                                                                                                                                                 \
+    StringVectorPushMany(vector, __VA_ARGS__);                                                                                                                                                                                                 \
+    linkTargets(&vector);                                                                                                                                                                                                                      \
+  })
+
 static void addFile(String source);
 #define AddFile(source) addFile(FixPath(S(source)));
 
 static void addDirectory(String dir);
 #define AddDirectory(dir) addDirectory(S(dir));
 
+static void addPrecompiledHeader(String header);
+#define AddPrecompiledHeader(header) addPrecompiledHeader(S(header));
+
 static StringVector _validFileExtensions = {0};
 
 #define AllowFileExtensions(...) StringVectorPushMany(_validFileExtensions, __VA_ARGS__)
 
-String InstallExecutable();
+String AddTarget(); // NOTE: Adds the current target to the graph without building it
+String InstallExecutable(); // NOTE: Builds every added target and the current one, the path it returns outlives EndBuild
+String InstallLibrary();
 i32 RunCommand(String command);
 void EndBuild();
 
 static bool needRebuild();
+static void rebuild();
+static bool isJobStale(BuildJob *job);
+#ifdef PLATFORM_LINUX
+static void runWorker(String address);
+#endif
 static void setDefaultState();
 
 #ifdef BILT_IMPLEMENTATION
 
 static BiltConfig state = {0};
 static Executable executable = {0};
+static TargetVector targets = {0};
+static BuildJobVector compileJobs = {0};
+static BuildJobVector pchJobs = {0};
+static BuildJobVector linkJobs = {0};
+static WorkerVector workers = {0};
+static TraceSpanVector traceSpans = {0}; // NOTE: Every job that ran, written to trace.json by EndBuild
+static Arena buildArena = {0}; // NOTE: Every String made between StartBuild and EndBuild, freed at once by EndBuild
+
+typedef enum {
+  PROFILE_NONE,
+  PROFILE_GENERATE,
+  PROFILE_USE,
+} ProfileMode;
+
+static ProfileMode profileMode = PROFILE_NONE;
+static String profileFlags = {0}; // NOTE: Compile and link flags of the current PGO pass
+static String profileStamp = {0}; // NOTE: Touched whenever the profile is retrained
+static String profileBuildDirectory = {0}; // NOTE: Build directory of the optimized pass
+static String lastObjectDirectory = {0}; // NOTE: Last directory makeObjectDirectory created
+static String compilerIdentityCache = {0};
+
+typedef enum {
+  TOOLCHAIN_GCC,
+  TOOLCHAIN_CLANG,
+  TOOLCHAIN_MSVC,
+} Toolchain;
+
+HASHMAP_TYPE(ToolchainMap, String, Toolchain, HashStringKey, StrEqual)
+HASHMAP_TYPE(JobMap, String, BuildJob *, HashStringKey, StrEqual)
+
+static ToolchainMap toolchains = {0};
+
+// NOTE: Matches the compiler's file name without its directory, `.exe` and version (`clang-17`), anything unknown
+// like a cross compiler's prefixed name counts as clang when it says so and as gcc otherwise
+static Toolchain compilerToolchain(String compiler) {
+  if (toolchains.size == 0) {
+    ToolchainMapInsert(&toolchains, S("gcc"), TOOLCHAIN_GCC);
+    ToolchainMapInsert(&toolchains, S("g++"), TOOLCHAIN_GCC);
+    ToolchainMapInsert(&toolchains, S("cc"), TOOLCHAIN_GCC);
+    ToolchainMapInsert(&toolchains, S("c++"), TOOLCHAIN_GCC);
+    ToolchainMapInsert(&toolchains, S("clang"), TOOLCHAIN_CLANG);
+    ToolchainMapInsert(&toolchains, S("clang++"), TOOLCHAIN_CLANG);
+    ToolchainMapInsert(&toolchains, S("cl"), TOOLCHAIN_MSVC);
+    ToolchainMapInsert(&toolchains, S("clang-cl"), TOOLCHAIN_MSVC);
+    ToolchainMapInsert(&toolchains, S("MSVC"), TOOLCHAIN_MSVC);
+  }
+
+  size_t start = compiler.length;
+  while (start > 0 && compiler.data[start - 1] != '/' && compiler.data[start - 1] != '\\') {
+    start--;
+  }
+  String name = {.length = compiler.length - start, .data = compiler.data + start};
+  if (name.length > 4 && strncmp(name.data + name.length - 4, ".exe", 4) == 0) {
+    name.length -= 4;
+  }
+
+  size_t end = name.length;
+  while (end > 0 && (isdigit((u8)name.data[end - 1]) || name.data[end - 1] == '.')) {
+    end--;
+  }
+  if (end > 0 && end < name.length && name.data[end - 1] == '-') {
+    name.length = end - 1;
+  }
+
+  Toolchain *toolchain = ToolchainMapFind(&toolchains, name);
+  if (toolchain != NULL) {
+    return *toolchain;
+  }
+  return strstr(compiler.data, "clang") != NULL ? TOOLCHAIN_CLANG : TOOLCHAIN_GCC;
+}
+
+static bool usesClang() {
+  return compilerToolchain(state.compiler) == TOOLCHAIN_CLANG;
+}
 
 String FixPathExe(String str) {
-  String path = ConvertPath(ConvertExe(str));
+  String path = ConvertExe(StrViewOf(str));
   String cwd = GetCwd();
 #if defined(PLATFORM_WIN)
   String formatted_path = FormatMalloc("%s\\%s", cwd.data, path.data);
 #elif defined(PLATFORM_LINUX)
   String formatted_path = FormatMalloc("%s/%s", cwd.data, path.data);
 #endif
-  StrFree(cwd);
   return formatted_path;
 }
 
 String FixPath(String str) {
-  String path = ConvertPath(str);
+  String path = ConvertPath(StrViewOf(str));
   String cwd = GetCwd();
 #if defined(PLATFORM_WIN)
   String formatted = FormatMalloc("%s\\%s", cwd.data, path.data);
 #elif defined(PLATFORM_LINUX)
   String formatted = FormatMalloc("%s/%s", cwd.data, path.data);
 #endif
-  StrFree(cwd);
   return formatted;
 }
 
@@ -146,21 +336,56 @@ String ConvertNinjaPath(String str) {
 #endif
 }
 
+// NOTE: The configuration outlives the build, so it's made before StartBuild turns on the arena
 static void setDefaultState() {
   state.source = FixPath(S("./bilt.c"));
   state.cachePath = FixPath(S("./build/bilt-cache.json"));
-  state.exe = FixPath(S("./bilt"));
-  state.buildDirectory = ConvertPath(S("./build"));
+  state.exe = FixPathExe(S("./bilt"));
+  state.buildDirectory = ConvertPath(SV("./build"));
   state.compiler = GetCompiler();
+  state.backend = BACKEND_AUTO;
+  state.jobs = ProcessorCount() + 2;
+  state.compileCache = (String){0};
+  state.compileCacheSize = 5LL * 1024 * 1024 * 1024;
+}
+
+static BiltBackend parseBackend(String backend) {
+  if (StrEqual(backend, S("ninja"))) {
+    return BACKEND_NINJA;
+  }
+
+  if (StrEqual(backend, S("native"))) {
+    return BACKEND_NATIVE;
+  }
+
+  LogError("Unknown backend %s, use \"ninja\" or \"native\"", backend.data);
+  abort();
 }
 
 static BiltConfig parseBiltConfig(BiltOptions options) {
-  BiltConfig result;
+  BiltConfig result = {0};
   result.compiler = StrNew(options.compiler);
   result.buildDirectory = StrNew(options.buildDirectory);
   result.exe = StrNew(options.exe);
   result.cachePath = StrNew(options.cachePath);
   result.source = StrNew(options.source);
+  result.backend = options.backend == NULL ? BACKEND_AUTO : parseBackend(s(options.backend));
+  result.jobs = options.jobs;
+  result.compileCache = StrNew(options.compileCache);
+  result.compileCacheSize = options.compileCacheSize;
+  result.profileTraining = StrNew(options.profileTraining);
+  result.timeTrace = options.timeTrace;
+  if (options.workers != NULL) {
+    String addresses = s(options.workers);
+    String separator = S(",");
+    StringVector split = StrSplit(&addresses, &separator);
+    for (size_t i = 0; i < split.length; i++) {
+      StrTrim(VecAt(split, i));
+      if (VecAt(split, i)->length > 0) {
+        VecPush(result.workerAddresses, *VecAt(split, i));
+      }
+    }
+  }
   return result;
 }
 
@@ -177,56 +402,245 @@ void CreateConfig(BiltOptions options) {
   }
 
   if (!StrIsNull(&config.exe)) {
-    state.exe = FixPath(config.exe);
+    state.exe = FixPathExe(config.exe);
   }
 
   if (!StrIsNull(&config.buildDirectory)) {
-    state.buildDirectory = ConvertPath(config.buildDirectory);
+    state.buildDirectory = ConvertPath(StrViewOf(config.buildDirectory));
   }
 
   if (!StrIsNull(&config.compiler)) {
     state.compiler = config.compiler;
   }
 
+  if (config.backend != BACKEND_AUTO) {
+    state.backend = config.backend;
+  }
+
+  if (config.jobs > 0) {
+    state.jobs = config.jobs;
+  }
+
+  if (!StrIsNull(&config.compileCache)) {
+    state.compileCache = ConvertPath(StrViewOf(config.compileCache));
+  }
+
+  if (config.compileCacheSize > 0) {
+    state.compileCacheSize = config.compileCacheSize;
+  }
+
+  if (config.workerAddresses.length > 0) {
+    state.workerAddresses = config.workerAddresses;
+  }
+
+  if (!StrIsNull(&config.profileTraining)) {
+    state.profileTraining = config.profileTraining;
+  }
+
+  state.timeTrace = config.timeTrace;
   state.customConfig = true;
 }
 
+static bool readCacheValue(String cache, char *key, i32 base, u64 *value) {
+  String pattern = FormatMalloc("\"%s\":", key);
+  char *match = strstr(cache.data, pattern.data);
+  StrFree(pattern);
+  if (match == NULL) {
+    return false;
+  }
+
+  char *curr = match + strlen(key) + 3;
+  while (isspace(*curr) || *curr == '"') {
+    curr++;
+  }
+  *value = strtoull(curr, NULL, base);
+  return true;
+}
+
+errno_t writeCache() {
+  String cache = FormatMalloc("{\n  \"lastBuild\": %lld,\n  \"profileHash\": \"%016llx\"\n}\n",
+                              (long long)state.cache.lastBuild,
+                              (unsigned long long)state.cache.profileHash);
+  errno_t err = FileWrite(&state.cachePath, &cache);
+  StrFree(cache);
+  return err;
+}
+
 errno_t readCache() {
   String cache = S("");
   errno_t err = FileRead(&state.cachePath, &cache);
 
   if (err == FILE_NOT_EXIST) {
-    String modifyTime = FormatMalloc("%llu", TimeNow() / 1000);
-    FileWrite(&state.cachePath, &modifyTime);
+    state.cache.lastBuild = TimeNow() / 1000;
     state.cache.firstBuild = true;
-    cache = modifyTime;
+    return writeCache();
   } else if (err != SUCCESS) {
     return err;
   }
 
-  char *endptr;
-  state.cache.lastBuild = strtoll(cache.data, &endptr, 10);
+  u64 value;
+  if (readCacheValue(cache, "lastBuild", 10, &value)) {
+    state.cache.lastBuild = (i64)value;
+  } else {
+    // NOTE: Caches from older versions only hold the timestamp
+    state.cache.lastBuild = strtoll(cache.data, NULL, 10);
+  }
+
+  if (readCacheValue(cache, "profileHash", 16, &value)) {
+    state.cache.profileHash = value;
+  }
   return SUCCESS;
 }
 
+static void collectFiles(Folder *folder, char *extension, StringVector *result) {
+  for (size_t i = 0; i < folder->fileCount; i++) {
+    File *file = &folder->files[i];
+    if (file->extension != NULL && strcmp(file->extension, extension) == 0) {
+      VecPush((*result), FormatMalloc("%s/%s", folder->name.data, file->name.data));
+    }
+  }
+
+  for (size_t i = 0; i < folder->folderCount; i++) {
+    collectFiles(&folder->folders[i], extension, result);
+  }
+}
+
+// NOTE: The self rebuild writes a depfile with every header the driver includes. A driver compiled by hand has none,
+// then the headers in the `core` directory next to bilt.h are checked
+static bool driverHeadersChanged(String header, i64 exeTime) {
+  BuildJob driver = {0};
+  driver.output = state.exe;
+  driver.depfile = FormatMalloc("%s.d", state.exe.data);
+  i64 depfileTime;
+  if (FileModifyTime(&driver.depfile, &depfileTime) == SUCCESS) {
+    return isJobStale(&driver);
+  }
+
+  size_t directoryLength = header.length;
+  while (directoryLength > 0 && header.data[directoryLength - 1] != '/' && header.data[directoryLength - 1] != '\\') {
+    directoryLength--;
+  }
+  String core = FormatMalloc("%.*score", (int)directoryLength, header.data);
+  i64 coreTime;
+  if (FileModifyTime(&core, &coreTime) != SUCCESS) {
+    return false;
+  }
+
+  Folder *folder = GetDirFiles(core);
+  StringVector headers = {0};
+  collectFiles(folder, "h", &headers);
+  FreeFolder(folder);
+
+  bool changed = false;
+  for (size_t i = 0; i < headers.length && !changed; i++) {
+    i64 headerTime;
+    changed = FileModifyTime(VecAt(headers, i), &headerTime) == SUCCESS && headerTime > exeTime;
+  }
+  if (headers.data != NULL) {
+    VecFree(headers);
+  }
+  return changed;
+}
+
+static bool needRebuild() {
+  i64 exeTime;
+  if (FileModifyTime(&state.exe, &exeTime) != SUCCESS) {
+    return false; // NOTE: Ran from somewhere else, nothing to compare against
+  }
+
+  // NOTE: __FILE__ is the path the driver was compiled with, only a relative one is taken from the working directory
+  String header = S(__FILE__);
+  bool absolute = header.data[0] == '/' || header.data[0] == '\\' || (header.length > 2 && header.data[1] == ':');
+  if (!absolute) {
+    header = FixPath(header);
+  }
+
+  String inputs[] = {state.source, header};
+  for (size_t i = 0; i < sizeof(inputs) / sizeof(inputs[0]); i++) {
+    i64 inputTime;
+    if (FileModifyTime(&inputs[i], &inputTime) != SUCCESS) {
+      LogWarn("Couldn't find %s, changes to it won't rebuild %s", inputs[i].data, state.exe.data);
+    } else if (inputTime > exeTime) {
+      LogInfo("%s changed since the last build", inputs[i].data);
+      return true;
+    }
+  }
+
+  if (driverHeadersChanged(header, exeTime)) {
+    LogInfo("A header %s includes changed since the last build", state.source.data);
+    return true;
+  }
+  return false;
+}
+
+// NOTE: Recompiles the driver and runs it again with the same arguments, the old binary is kept until it succeeds
+static void rebuild() {
+  String oldExe = FormatMalloc("%s.old", state.exe.data);
+  if (FileRename(&state.exe, &oldExe) != SUCCESS) {
+    LogError("Couldn't move %s out of the way", state.exe.data);
+    abort();
+  }
+
+  errno_t result = RunCommand(FormatMalloc("%s -MMD -MF %s.d %s -o %s", state.compiler.data, state.exe.data, state.source.data, state.exe.data));
+  if (result != SUCCESS) {
+    FileRename(&oldExe, &state.exe);
+    LogError("Rebuilding %s failed with code: %d", state.source.data, result);
+    abort();
+  }
+
+  LogSuccess("Rebuilt %s", state.exe.data);
+  setenv("BILT_REBUILT", "1", true);
+  ProcessRestart(state.exe);
+  abort();
+}
+
 void StartBuild() {
   LogInit();
   if (!state.customConfig) {
     setDefaultState();
   }
+  StrSetArena(&buildArena);
 
   state.startTime = TimeNow();
   Mkdir(state.buildDirectory);
   readCache();
+
+  // NOTE: The environment variable guards against rebuild loops when timestamps are in the future
+  if (getenv("BILT_REBUILT") == NULL && needRebuild()) {
+    rebuild();
+  }
+  unsetenv("BILT_REBUILT");
+
+  // NOTE: Left behind by the last self rebuild, windows only lets it go once the process that waited on us exited
+  String oldExe = FormatMalloc("%s.old", state.exe.data);
+  remove(oldExe.data);
+
+  StringVector arguments = ProcessArguments();
+  bool worker = arguments.length >= 3 && StrEqual(*VecAt(arguments, 1), S("--worker"));
+#ifdef PLATFORM_LINUX
+  if (worker) {
+    runWorker(*VecAt(arguments, 2));
+  }
+#else
+  if (worker || state.workerAddresses.length > 0) {
+    LogError("Build workers are only implemented on linux");
+    abort();
+  }
+#endif
 }
 
 void defaultExecutable() {
-  String executableOutput = ConvertExe(S("main"));
-  executable.output = ConvertPath(executableOutput);
+  executable = (Executable){0};
+  executable.kind = TARGET_EXECUTABLE;
+  executable.name = S("main");
+  executable.index = TARGET_NOT_ADDED;
+  executable.output = ConvertExe(SV("main"));
   executable.flags = S("");
   executable.linkerFlags = S("");
   executable.includes = S("");
   executable.libs = S("");
+  executable.precompiledHeader = (String){0};
+  executable.unityBatch = 0;
 }
 
 static Executable parseExecutableOptions(ExecutableOptions options) {
@@ -236,16 +650,64 @@ static Executable parseExecutableOptions(ExecutableOptions options) {
   result.linkerFlags = StrNew(options.linkerFlags);
   result.includes = StrNew(options.includes);
   result.libs = StrNew(options.libs);
+  result.precompiledHeader = StrNew(options.precompiledHeader);
+  result.unityBatch = options.unityBatch;
+  result.lto = StrNew(options.lto);
+  result.ltoJobs = options.ltoJobs;
+  result.splitDwarf = options.splitDwarf;
+  result.exports = (StringVector){0};
+  if (options.exports != NULL) {
+    String exports = s(options.exports);
+    String separator = S(" ");
+    StringVector split = StrSplit(&exports, &separator);
+    for (size_t i = 0; i < split.length; i++) {
+      if (VecAt(split, i)->length > 0) {
+        VecPush(result.exports, *VecAt(split, i));
+      }
+    }
+  }
   return result;
 }
 
+// NOTE: Fastest first, mold and lld link several times faster than bfd on big outputs
+static String resolveLinker(char *linker) {
+  if (linker == NULL) {
+    return (String){0};
+  }
+
+  char *known[] = {"mold", "lld", "gold", "bfd"};
+  bool automatic = strcmp(linker, "auto") == 0;
+  for (size_t i = 0; i < sizeof(known) / sizeof(known[0]); i++) {
+    if (!automatic && strcmp(linker, known[i]) != 0) {
+      continue;
+    }
+
+    String program = FormatMalloc("ld.%s", known[i]);
+    bool found = FindExecutable(program);
+    StrFree(program);
+    if (found) {
+      return s(known[i]);
+    }
+    if (!automatic) {
+      LogError("Couldn't find ld.%s in PATH", linker);
+      abort();
+    }
+  }
+
+  if (!automatic) {
+    LogError("Unknown linker %s, expected \"mold\", \"lld\", \"gold\", \"bfd\" or \"auto\"", linker);
+    abort();
+  }
+  return (String){0};
+}
+
 void CreateExecutable(ExecutableOptions executableOptions) {
   defaultExecutable();
   Executable options = parseExecutableOptions(executableOptions);
 
   if (!StrIsNull(&options.output)) {
-    String executableOutput = ConvertExe(options.output);
-    executable.output = ConvertPath(executableOutput);
+    executable.name = options.output;
+    executable.output = ConvertExe(StrViewOf(options.output));
   }
 
   if (!StrIsNull(&options.flags)) {
@@ -264,12 +726,115 @@ void CreateExecutable(ExecutableOptions executableOptions) {
     executable.libs = options.libs;
   }
 
-  if (executable.fileSet == NULL) {
-    executable.fileSet = HashSetNew(100);
+  if (!StrIsNull(&options.precompiledHeader)) {
+    executable.precompiledHeader = options.precompiledHeader;
   }
+
+  executable.unityBatch = options.unityBatch;
+  executable.exports = options.exports;
+  executable.ltoJobs = options.ltoJobs;
+
+  if (!StrIsNull(&options.lto)) {
+    if (!StrEqual(options.lto, S("full")) && !StrEqual(options.lto, S("thin"))) {
+      LogError("Unknown LTO mode %s, expected \"full\" or \"thin\"", options.lto.data);
+      abort();
+    }
+
+    if (StrEqual(options.lto, S("thin")) && !usesClang()) {
+      LogWarn("%s has no ThinLTO, using its parallel full LTO", state.compiler.data);
+      options.lto = S("full");
+    }
+    executable.lto = options.lto;
+    executable.flags = FormatMalloc("%s %s", executable.flags.data, StrEqual(executable.lto, S("thin")) ? "-flto=thin" : "-flto");
+  }
+
+  String linker = resolveLinker(executableOptions.linker);
+  if (!StrIsNull(&linker)) {
+    executable.linkerFlags = FormatMalloc("%s -fuse-ld=%s", executable.linkerFlags.data, linker.data);
+  }
+
+  if (executableOptions.gdbIndex) {
+    if (StrIsNull(&linker) || StrEqual(linker, S("bfd"))) {
+      LogWarn("The default linker can't write a .gdb_index, pick gold, lld or mold with .linker");
+    } else {
+      executable.linkerFlags = FormatMalloc("%s -Wl,--gdb-index", executable.linkerFlags.data);
+    }
+  }
+
+  executable.splitDwarf = executableOptions.splitDwarf;
+  if (executable.splitDwarf) {
+    executable.flags = FormatMalloc("%s -gsplit-dwarf", executable.flags.data);
+  }
+
+  // NOTE: -gz on the compile line reaches the assembler, on the link line the linker
+  if (executableOptions.compressDebug) {
+    executable.flags = FormatMalloc("%s -gz", executable.flags.data);
+    executable.linkerFlags = FormatMalloc("%s -gz", executable.linkerFlags.data);
+  }
+  executable.fileSet = HashSetNew(100);
+}
+
+static String libraryOutput(char *name, TargetKind kind) {
+  if (name == NULL) {
+    LogError("Libraries need an output name, i.e. .output = \"foo\" for libfoo");
+    abort();
+  }
+
+#ifdef PLATFORM_WIN
+  String output = FormatMalloc(kind == TARGET_STATIC_LIBRARY ? "%s.lib" : "%s.dll", name);
+#else
+  String output = FormatMalloc(kind == TARGET_STATIC_LIBRARY ? "lib%s.a" : "lib%s.so", name);
+#endif
+  return ConvertPath(StrViewOf(output));
+}
+
+void CreateStaticLibrary(ExecutableOptions executableOptions) {
+  CreateExecutable(executableOptions);
+  executable.kind = TARGET_STATIC_LIBRARY;
+  executable.output = libraryOutput(executableOptions.output, executable.kind);
+}
+
+void CreateSharedLibrary(ExecutableOptions executableOptions) {
+  CreateExecutable(executableOptions);
+  executable.kind = TARGET_SHARED_LIBRARY;
+  executable.output = libraryOutput(executableOptions.output, executable.kind);
+
+  // NOTE: Hidden by default keeps the dynamic symbol table small, an export list needs default visibility to name its symbols
+  // and hides the rest at link time instead
+  String visibility = executable.exports.length > 0 ? S("-fno-semantic-interposition") : S("-fvisibility=hidden");
+  executable.flags = FormatMalloc("%s -fPIC %s", executable.flags.data, visibility.data);
+  executable.linkerFlags = FormatMalloc("%s -shared", executable.linkerFlags.data);
+}
+
+static void writeJsonString(FILE *file, String str) {
+  fputc('"', file);
+  for (size_t i = 0; i < str.length; i++) {
+    char c = str.data[i];
+    if (c == '"' || c == '\\') {
+      fputc('\\', file);
+    }
+    fputc(c, file);
+  }
+  fputc('"', file);
+}
+
+static void writeCompileCommands(FILE *outputFile, String directory) {
+  fprintf(outputFile, "[\n");
+  for (size_t i = 0; i < compileJobs.length; i++) {
+    BuildJob *job = VecAt(compileJobs, i);
+    fprintf(outputFile, "  {\n    \"directory\": ");
+    writeJsonString(outputFile, directory);
+    fprintf(outputFile, ",\n    \"command\": ");
+    writeJsonString(outputFile, job->command);
+    fprintf(outputFile, ",\n    \"file\": ");
+    writeJsonString(outputFile, *VecAt(job->inputs, 0));
+    fprintf(outputFile, ",\n    \"output\": ");
+    writeJsonString(outputFile, job->output);
+    fprintf(outputFile, "\n  }%s\n", i + 1 == compileJobs.length ? "" : ",");
+  }
+  fprintf(outputFile, "]\n");
 }
 
-// TODO: Implement for linux
 // TODO: Add error enum
 errno_t CreateCompileCommands() {
   FILE *ninjaPipe;
@@ -279,10 +844,9 @@ errno_t CreateCompileCommands() {
   
   String cwd = GetCwd();
 
-  String buildPath = StrNew(FormatMalloc("%s/%s", cwd.data, ParsePath(state.buildDirectory).data).data);
-  String compileCommandsPath = ConvertPath(FormatMalloc("%s/compile_commands.json", buildPath.data));
-
-  StrFree(cwd);
+  StrView buildDirectory = ParsePath(StrViewOf(state.buildDirectory));
+  String buildPath = FormatMalloc("%s/%.*s", cwd.data, (int)buildDirectory.length, buildDirectory.data);
+  String compileCommandsPath = ConvertPath(StrViewOf(FormatMalloc("%s/compile_commands.json", buildPath.data)));
 
   outputFile = fopen(compileCommandsPath.data, "w");
   if (outputFile == NULL) {
@@ -290,7 +854,14 @@ errno_t CreateCompileCommands() {
     return 1;
   }
 
-  String compdbCommand = ConvertPath(FormatMalloc("ninja -f %s/build.ninja -t compdb", buildPath.data));
+  if (state.backend == BACKEND_NATIVE) {
+    writeCompileCommands(outputFile, cwd);
+    fclose(outputFile);
+    LogSuccess("Successfully created %s\n", compileCommandsPath.data);
+    return SUCCESS;
+  }
+
+  String compdbCommand = ConvertPath(StrViewOf(FormatMalloc("ninja -f %s/build.ninja -t compdb", buildPath.data)));
 
   ninjaPipe = popen(compdbCommand.data, "r");
   if (ninjaPipe == NULL) {
@@ -314,7 +885,9 @@ errno_t CreateCompileCommands() {
   return SUCCESS;
 }
 
+// NOTE: Sources are interned, so the duplicate check and every later compare of the same path is a pointer compare
 static void addFile(String source) {
+  source = StrIntern(source);
   LogInfo("Adding file %s", source.data);
   if (HashSetContains(executable.fileSet, source)) {
     LogInfo("File %s already exists", source.data);
@@ -343,7 +916,7 @@ static void _addDirectoryImpl(Folder *folder) {
       continue;
     }
     String fullPath = FormatMalloc("%s/%s", folder->name.data, curr->name.data);
-    addFile(ConvertPath(fullPath));
+    addFile(ConvertPath(StrViewOf(fullPath)));
   }
 
   for (int i = 0; i < folder->folderCount; i++) {
@@ -352,6 +925,10 @@ static void _addDirectoryImpl(Folder *folder) {
   }
 }
 
+static void addPrecompiledHeader(String header) {
+  executable.precompiledHeader = header;
+}
+
 static void addDirectory(String dir) {
   if (_validFileExtensions.data == 0) {
     VecPush(_validFileExtensions, S("c"));
@@ -362,152 +939,2173 @@ static void addDirectory(String dir) {
 }
 
 
-static StringVector outputTransformer(StringVector vector) {
-  StringVector result = {0};
-  String sep = ConvertPath(S("/"));
-  for (size_t i = 0; i < vector.length; i++) {
-    String *currentExecutable = VecAt(vector, i);
-    String output = S("");
-    for (size_t j = currentExecutable->length - 1; j > 0; j--) {
-      String currentChar = StrNewSize(&currentExecutable->data[j], 1);
-      if (StrEqual(sep, currentChar)) {
-        break;
-      }
-      output = StrConcat(&currentChar, &output);
-    }
-    output.data[output.length - 1] = 'o';
-    VecPush(result, output);
+static u64 hashBytes(u64 seed, char *data, size_t length) {
+  u64 result = seed; // NOTE: FNV-1a
+  for (size_t i = 0; i < length; i++) {
+    result ^= (u8)data[i];
+    result *= 1099511628211ULL;
   }
-
   return result;
 }
 
-// TODO: Make linux version
-String InstallExecutable() {
-  if (executable.sources.length == 0) {
-    LogError("Executable has zero sources, add at least one with AddFile(\"./main.c\")");
-    abort();
-  }
+static u64 hashString(String str) {
+  return hashBytes(14695981039346656037ULL, str.data, str.length);
+}
 
-  String linkCommand;
-  String compileCommand;
+static i32 compareStrings(const void *a, const void *b) {
+  return strcmp(((String *)a)->data, ((String *)b)->data);
+}
 
-  // TODO: a hashmap or something
-  if (StrEqual(state.compiler, S("MSVC"))) {
-    LogError("MSVC not yet implemented");
-    abort();
-  } else {
-    linkCommand = FormatMalloc("rule link\n  command = $cc $flags $linker_flags -o $out $in $libs\n");
-    compileCommand = FormatMalloc("rule compile\n  command = $cc $flags $includes -c $in -o $out\n");
-  }
-  String cwd = GetCwd();
-  String ninjaOutput = FormatMalloc(
-                         "cc = %s\n"
-                         "linker_flag = %s\n"
-                         "flags = %s\n"
-                         "cwd = %s\n"
-                         "builddir = $cwd/%s\n"
-                         "target = $builddir/%s\n"
-                         "includes = %s\n"
-                         "libs = %s\n"
-                         "\n"
-                         "%s\n"
-                         "%s\n",
-                         state.compiler.data,
-                         executable.linkerFlags.data,
-                         executable.flags.data,
-                         ConvertNinjaPath(StrNew(cwd.data)).data,
-                         state.buildDirectory.data,
-                         executable.output.data,
-                         executable.includes.data,
-                         executable.libs.data,
-                         linkCommand.data,
-                         compileCommand.data);
-  StrFree(cwd);
-  StringVector outputFiles = outputTransformer(executable.sources);
+static String nativeLogPath() {
+  return FixPath(FormatMalloc("%s/.bilt_log", state.buildDirectory.data));
+}
 
-  assert(outputFiles.length == executable.sources.length && "Something went wrong in the parsing");
+static String nativeLogEntry(BuildJob *job) {
+  return FormatMalloc("%016llx %s", (unsigned long long)hashString(job->command), job->output.data);
+}
 
-  String outputString = S("");
-  for (size_t i = 0; i < executable.sources.length; i++) {
-    String sourceFile = ConvertNinjaPath(*VecAt(executable.sources, i));
-    String outputFile = *VecAt(outputFiles, i);
-    String source = FormatMalloc("build $builddir/%s: compile %s\n", outputFile.data, sourceFile.data);
-    ninjaOutput = StrConcat(&ninjaOutput, &source);
-    outputString = FormatMalloc("%s $builddir/%s", outputString.data, outputFile.data);
+// NOTE: Sorted "<command hash> <output>" lines of the last native build, same idea as `.ninja_log`
+static StringVector readNativeLog() {
+  StringVector result = {0};
+  String logPath = nativeLogPath();
+  String content = {0};
+  if (FileRead(&logPath, &content) != SUCCESS || content.length == 0) {
+    return result;
   }
 
-  String target = FormatMalloc(
-                    "build $target: link%s\n"
-                    "\n"
-                    "default $target\n",
-                    outputString.data);
-  ninjaOutput = StrConcat(&ninjaOutput, &target);
-
-  String relativeBuildPath = FormatMalloc("%s/build.ninja", state.buildDirectory.data);
-  String buildNinjaPath = FixPath(relativeBuildPath);
-  FileWrite(&buildNinjaPath, &ninjaOutput);
+  // NOTE: The lines point into `content`, which stays alive with them. Overwriting each `\n` terminates them for strcmp
+  String newline = S("\n");
+  StringVector lines = StrSplitView(&content, &newline);
+  for (size_t i = 0; i < lines.length; i++) {
+    String *line = VecAt(lines, i);
+    line->data[line->length] = '\0';
+    if (line->length != 0) {
+      VecPush(result, *line);
+    }
+  }
+  VecFree(lines);
 
-  
-  errno_t result = RunCommand(FormatMalloc("ninja -f %s", buildNinjaPath.data));
-  if (result != 0) {
-    LogError("Ninja file compilation failed with code: %d", result);
-    abort();
+  if (result.length > 0) {
+    qsort(result.data, result.length, sizeof(String), compareStrings);
   }
-  
-  LogSuccess("Ninja file compilation done");
-  state.totalTime = TimeNow() - state.startTime;
-  
-  String relativeExePath = FormatMalloc("%s/%s", state.buildDirectory.data, executable.output.data);
-  String fullExePath = FixPath(relativeExePath);
-  return fullExePath;
+  return result;
 }
 
-errno_t RunCommand(String command) {
-  return system(command.data);
+static void writeNativeLog(BuildJobVector *jobs) {
+  String logPath = nativeLogPath();
+  StrBuilder builder = StrBuilderNew(jobs->length * 64);
+  for (size_t i = 0; i < jobs->length; i++) {
+    BuildJob *job = VecAt((*jobs), i);
+    if (!job->succeeded) {
+      continue;
+    }
+    String entry = nativeLogEntry(job);
+    StrBuilderAppendFormat(&builder, "%s\n", entry.data);
+    StrFree(entry);
+  }
+  String content = StrBuilderToString(&builder);
+  FileWrite(&logPath, &content);
+  StrFree(content);
 }
 
-// TODO: Allocate total string size instead of concat
-// TODO: Do it depending on compiler
-static void addLibraryPaths(StringVector *vector) {
-  for (size_t i = 0; i < vector->length; i++) {
-    String *currLib = VecAt((*vector), i);
-    if (i == 0 && executable.libs.length == 0) {
-      executable.libs = FormatMalloc("-L\"%s\"", currLib->data);
+// NOTE: Parses the first rule of a make style depfile (`out: in1 in2 \`), handles `\ ` and `$$` escapes
+static StringVector parseDepfile(String content) {
+  StringVector result = {0};
+  size_t i = 0;
+
+  // NOTE: Skips the target, a `:` followed by a drive letter separator is part of a windows path
+  while (i < content.length && !(content.data[i] == ':' && (i + 1 == content.length || isspace(content.data[i + 1])))) {
+    i++;
+  }
+  i++;
+
+  // NOTE: Plain path bytes are scanned and copied in bulk, only whitespace and escapes are looked at one by one
+  char *token = malloc(content.length + 1);
+  size_t tokenLength = 0;
+  while (i <= content.length) {
+    size_t run = i < content.length ? StrScanAny(content.data + i, content.length - i, " \t\n\r\v\f\\$") : 0;
+    memcpy(token + tokenLength, content.data + i, run);
+    tokenLength += run;
+    i += run;
+
+    char c = i < content.length ? content.data[i] : '\n';
+    if (c == '\\' && i + 1 < content.length && (content.data[i + 1] == '\n' || content.data[i + 1] == '\r')) {
+      i++;
+      c = ' ';
+    } else if (c == '\\' && i + 1 < content.length && (content.data[i + 1] == ' ' || content.data[i + 1] == '#')) {
+      token[tokenLength++] = content.data[i + 1];
+      i += 2;
+      continue;
+    } else if (c == '$' && i + 1 < content.length && content.data[i + 1] == '$') {
+      token[tokenLength++] = '$';
+      i += 2;
+      continue;
+    }
+
+    if (!isspace(c)) {
+      token[tokenLength++] = c;
+      i++;
       continue;
     }
 
-    executable.libs = FormatMalloc("%s -L\"%s\"", executable.libs.data, currLib->data);
+    if (tokenLength > 0) {
+      VecPush(result, StrNewSize(token, tokenLength));
+      tokenLength = 0;
+    }
+
+    if (c == '\n') {
+      break;
+    }
+    i++;
   }
+
+  free(token);
+  return result;
 }
 
-// TODO: Same thing here
-static void addIncludePaths(StringVector *vector) {
-  size_t i;
-  for (i = 0; i < vector->length; i++) {
-    String *currInclude = VecAt((*vector), i);
-    if (i == 0 && executable.includes.length == 0) {
-      executable.includes = FormatMalloc("-I\"%s\"", currInclude->data);
-      continue;
+static bool isJobStale(BuildJob *job) {
+  i64 outputTime;
+  if (FileModifyTime(&job->output, &outputTime) != SUCCESS) {
+    return true;
+  }
+
+  for (size_t i = 0; i < job->inputs.length; i++) {
+    i64 inputTime;
+    if (FileModifyTime(VecAt(job->inputs, i), &inputTime) != SUCCESS || inputTime > outputTime) {
+      return true;
     }
+  }
+
+  if (StrIsNull(&job->depfile)) {
+    return false;
+  }
+
+  String content = {0};
+  if (FileRead(&job->depfile, &content) != SUCCESS) {
+    return true; // NOTE: Built before depfiles existed, so its headers are unknown
+  }
+
+  // NOTE: The parsed headers are only needed here, the mark hands their arena space back for the next job
+  ArenaMark mark = ArenaGetMark(&buildArena);
+  StringVector dependencies = parseDepfile(content);
+  bool stale = false;
+  for (size_t i = 0; i < dependencies.length && !stale; i++) {
+    i64 inputTime;
+    stale = FileModifyTime(VecAt(dependencies, i), &inputTime) != SUCCESS || inputTime > outputTime;
+  }
 
-    executable.includes = FormatMalloc("%s -I\"%s\"", executable.includes.data, currInclude->data);
+  if (dependencies.data != NULL) {
+    VecFree(dependencies);
   }
+  ArenaReset(&buildArena, mark);
+  FileFreeContent(content);
+  return stale;
 }
 
-static void linkSystemLibraries(StringVector *vector) {
-  for (size_t i = 0; i < vector->length; i++) {
-    String *currLib = VecAt((*vector), i);
-    if (i == 0 && executable.libs.length == 0) {
-      executable.libs = FormatMalloc("-l%s", currLib->data);
-      continue;
-    }
+static bool isJobDirty(BuildJob *job, StringVector *log) {
+  if (isJobStale(job)) {
+    return true;
+  }
+
+  String entry = nativeLogEntry(job);
+  bool known = log->length > 0 && bsearch(&entry, log->data, log->length, sizeof(String), compareStrings) != NULL;
+  StrFree(entry);
+  return !known;
+}
+
+/* --- Workers ---
+  NOTE: Requests and replies are length prefixed, both ends are expected to share the same endianness. Every request
+  carries the token from BILT_WORKER_TOKEN, workers drop connections that don't have theirs. Workers need fork and
+  sockets so they are linux only, StartBuild refuses them elsewhere
+*/
+#ifdef PLATFORM_LINUX
+#define WORKER_MAGIC 0x544c4942
+#define WORKER_REJECTED -1
+#define WORKER_TOKEN_VARIABLE "BILT_WORKER_TOKEN"
+#define WORKER_MAX_FIELD (64 * 1024)          // NOTE: Compiler, flags, extension and token
+#define WORKER_MAX_PAYLOAD (512 * 1024 * 1024) // NOTE: Preprocessed sources, objects and diagnostics
+
+enum WorkerRequest {
+  WORKER_HELLO = 'H',
+  WORKER_COMPILE = 'C',
+};
 
-    executable.libs = FormatMalloc("%s -l%s", executable.libs.data, currLib->data);
+typedef struct {
+  BuildJob *job;
+  Worker *worker;
+} RemoteTask;
+
+static errno_t sendString(Socket socket, String str) {
+  u32 length = (u32)str.length;
+  errno_t err = NetSend(socket, &length, sizeof(length));
+  if (err != SUCCESS || length == 0) {
+    return err;
   }
+  return NetSend(socket, str.data, length);
 }
 
-void EndBuild() {
-  LogInfo("Build took: %llums", state.totalTime);
+static errno_t receiveString(Socket socket, String *result, size_t maxLength) {
+  u32 length;
+  errno_t err = NetReceive(socket, &length, sizeof(length));
+  if (err != SUCCESS) {
+    return err;
+  }
+
+  if (length > maxLength) {
+    LogWarn("Refusing a %u byte message, the limit is %zu", length, maxLength);
+    return NET_RECEIVE_FAILED;
+  }
+
+  char *data = malloc((size_t)length + 1);
+  if (length > 0 && NetReceive(socket, data, length) != SUCCESS) {
+    free(data);
+    return NET_RECEIVE_FAILED;
+  }
+  data[length] = '\0';
+  *result = (String){length, data};
+  return SUCCESS;
+}
+
+static String workerToken = {0};
+
+// NOTE: Looks at every byte whatever the first mismatch, so the time taken doesn't give the token away
+static bool workerTokenMatches(String token) {
+  u8 difference = token.length == workerToken.length ? 0 : 1;
+  for (size_t i = 0; i < token.length && i < workerToken.length; i++) {
+    difference |= (u8)(token.data[i] ^ workerToken.data[i]);
+  }
+  return difference == 0;
+}
+
+// NOTE: Runs the compiler directly with the flags split on spaces, nothing the client sends reaches a shell
+static i32 workerCompile(String flags, String input, String output, String log) {
+  StringVector arguments = {0};
+  VecPush(arguments, state.compiler);
+  String space = S(" ");
+  StringVector split = StrSplit(&flags, &space);
+  for (size_t i = 0; i < split.length; i++) {
+    if (VecAt(split, i)->length > 0) {
+      VecPush(arguments, *VecAt(split, i));
+    }
+  }
+  StringVectorPushMany(arguments, "-c", input.data, "-o", output.data);
+
+  Process process;
+  size_t finished;
+  if (ProcessSpawnArguments(arguments, log, &process) != SUCCESS || ProcessWait(&process, 1, &finished) != SUCCESS) {
+    return 1;
+  }
+  return process.exitCode == 0 ? 0 : 1;
+}
+
+static i32 handleWorkerConnection(void *argument) {
+  Socket client = *(Socket *)argument;
+  u32 header[2];
+  String token;
+  if (NetReceive(client, header, sizeof(header)) != SUCCESS || header[0] != WORKER_MAGIC ||
+      receiveString(client, &token, WORKER_MAX_FIELD) != SUCCESS || !workerTokenMatches(token)) {
+    return 1;
+  }
+
+  if (header[1] == WORKER_HELLO) {
+    u32 slots = (u32)ProcessorCount();
+    return NetSend(client, &slots, sizeof(slots)) == SUCCESS ? 0 : 1;
+  }
+
+  String compiler, flags, extension, preprocessed;
+  if (receiveString(client, &compiler, WORKER_MAX_FIELD) != SUCCESS || receiveString(client, &flags, WORKER_MAX_FIELD) != SUCCESS ||
+      receiveString(client, &extension, WORKER_MAX_FIELD) != SUCCESS || receiveString(client, &preprocessed, WORKER_MAX_PAYLOAD) != SUCCESS) {
+    return 1;
+  }
+
+  i32 exitCode = WORKER_REJECTED;
+  String diagnostics = S("");
+  String object = S("");
+  if (!StrEqual(compiler, state.compiler)) {
+    diagnostics = FormatMalloc("worker compiles with %s, not %s", state.compiler.data, compiler.data);
+  } else if (!StrEqual(extension, S("i")) && !StrEqual(extension, S("ii"))) {
+    diagnostics = S("worker only compiles preprocessed .i and .ii sources");
+  } else {
+    String base = FixPath(FormatMalloc("%s/worker-%d", state.buildDirectory.data, (i32)getpid()));
+    String input = FormatMalloc("%s.%s", base.data, extension.data);
+    String output = FormatMalloc("%s.o", base.data);
+    String log = FormatMalloc("%s.log", base.data);
+
+    FileWrite(&input, &preprocessed);
+    exitCode = workerCompile(flags, input, output, log);
+    FileRead(&log, &diagnostics);
+    if (exitCode == 0 && FileRead(&output, &object) != SUCCESS) {
+      exitCode = 1;
+    }
+
+    remove(input.data);
+    remove(output.data);
+    remove(log.data);
+  }
+
+  bool sent = NetSend(client, &exitCode, sizeof(exitCode)) == SUCCESS && sendString(client, diagnostics) == SUCCESS && sendString(client, object) == SUCCESS;
+  NetClose(client);
+  return sent ? 0 : 1;
+}
+
+// NOTE: Serves compile requests forever, every connection gets its own process
+static void runWorker(String address) {
+  char *token = getenv(WORKER_TOKEN_VARIABLE);
+  if (token == NULL || token[0] == '\0') {
+    LogError("Set %s to the token the builds will send before starting a worker", WORKER_TOKEN_VARIABLE);
+    abort();
+  }
+  workerToken = s(token);
+
+  Socket listener;
+  if (NetListen(address, &listener) != SUCCESS) {
+    abort();
+  }
+
+  LogInfo("Worker listening on %s with %d slots, compiling with %s", address.data, ProcessorCount(), state.compiler.data);
+  while (true) {
+    ProcessReapFinished();
+    Socket client;
+    if (NetAccept(listener, &client) != SUCCESS) {
+      continue;
+    }
+
+    Process process;
+    ProcessFork(handleWorkerConnection, &client, &process);
+    NetClose(client);
+  }
+}
+
+static void registerWorkers() {
+  workers.length = 0;
+  char *token = getenv(WORKER_TOKEN_VARIABLE);
+  if (state.workerAddresses.length > 0 && (token == NULL || token[0] == '\0')) {
+    LogWarn("%s isn't set, building without the workers", WORKER_TOKEN_VARIABLE);
+    return;
+  }
+  workerToken = state.workerAddresses.length > 0 ? s(token) : (String){0};
+
+  for (size_t i = 0; i < state.workerAddresses.length; i++) {
+    String address = *VecAt(state.workerAddresses, i);
+    Socket socket;
+    u32 header[2] = {WORKER_MAGIC, WORKER_HELLO};
+    u32 slots = 0;
+
+    if (NetConnect(address, &socket) != SUCCESS) {
+      LogWarn("Worker %s is unreachable", address.data);
+      continue;
+    }
+    bool answered = NetSend(socket, header, sizeof(header)) == SUCCESS && sendString(socket, workerToken) == SUCCESS &&
+                    NetReceive(socket, &slots, sizeof(slots)) == SUCCESS;
+    NetClose(socket);
+
+    if (!answered || slots == 0) {
+      LogWarn("Worker %s didn't answer", address.data);
+      continue;
+    }
+
+    LogInfo("Worker %s has %u slots", address.data, slots);
+    VecPush(workers, ((Worker){.address = address, .slots = (i32)slots, .running = 0}));
+  }
+}
+
+// NOTE: Runs in its own process, falls back to compiling locally when the worker can't take the job
+static i32 remoteCompile(void *argument) {
+  RemoteTask *task = argument;
+  BuildJob *job = task->job;
+  String preprocessedPath = FormatMalloc("%s.i", job->output.data);
+  String preprocessed = {0};
+  if (RunCommand(job->preprocessCommand) != SUCCESS || FileRead(&preprocessedPath, &preprocessed) != SUCCESS) {
+    return 1; // NOTE: The compiler already reported why
+  }
+  remove(preprocessedPath.data);
+
+  String source = *VecAt(job->inputs, 0);
+  String extension = source.data[source.length - 1] == 'c' && source.data[source.length - 2] == '.' ? S("i") : S("ii");
+  u32 header[2] = {WORKER_MAGIC, WORKER_COMPILE};
+  i32 exitCode = WORKER_REJECTED;
+  String diagnostics = {0};
+  String object = {0};
+
+  Socket socket;
+  errno_t err = NetConnect(task->worker->address, &socket);
+  if (err == SUCCESS) {
+    bool exchanged = NetSend(socket, header, sizeof(header)) == SUCCESS &&
+                     sendString(socket, workerToken) == SUCCESS &&
+                     sendString(socket, state.compiler) == SUCCESS &&
+                     sendString(socket, job->remoteFlags) == SUCCESS &&
+                     sendString(socket, extension) == SUCCESS &&
+                     sendString(socket, preprocessed) == SUCCESS &&
+                     NetReceive(socket, &exitCode, sizeof(exitCode)) == SUCCESS &&
+                     receiveString(socket, &diagnostics, WORKER_MAX_PAYLOAD) == SUCCESS &&
+                     receiveString(socket, &object, WORKER_MAX_PAYLOAD) == SUCCESS;
+    NetClose(socket);
+    err = exchanged ? SUCCESS : NET_RECEIVE_FAILED;
+  }
+
+  if (err != SUCCESS || exitCode == WORKER_REJECTED) {
+    LogWarn("Worker %s couldn't compile %s%s%s, compiling locally", task->worker->address.data, source.data, StrIsNull(&diagnostics) ? "" : ": ", StrIsNull(&diagnostics) ? "" : diagnostics.data);
+    return RunCommand(job->command) == SUCCESS ? 0 : 1;
+  }
+
+  if (diagnostics.length > 0) {
+    fprintf(stderr, "%s", diagnostics.data);
+  }
+
+  if (exitCode == 0 && FileWrite(&job->output, &object) != SUCCESS) {
+    return 1;
+  }
+  return exitCode;
+}
+
+static errno_t startRemoteCompile(BuildJob *job, Worker *worker, Process *process) {
+  RemoteTask task = {job, worker};
+  return ProcessFork(remoteCompile, &task, process);
+}
+#else
+// NOTE: Never called, no job gets a worker when StartBuild refused them
+static void registerWorkers() {
+}
+
+static errno_t startRemoteCompile(BuildJob *job, Worker *worker, Process *process) {
+  return PROCESS_SPAWN_FAILED;
+}
+#endif
+
+static Worker *pickWorker() {
+  Worker *result = NULL;
+  for (size_t i = 0; i < workers.length; i++) {
+    Worker *worker = VecAt(workers, i);
+    if (worker->running >= worker->slots) {
+      continue;
+    }
+
+    if (result == NULL || (f64)worker->running / worker->slots < (f64)result->running / result->slots) {
+      result = worker;
+    }
+  }
+  return result;
+}
+
+static void recordSpan(TraceSpan span) {
+  assert(span.kind != NULL && "every job should have a kind for the trace");
+  VecPush(traceSpans, span);
+}
+
+// NOTE: Runs every job in `jobs` on at most `state.jobs` local processes plus the worker slots, stops scheduling on the first failure
+static errno_t runJobs(BuildJob **jobs, size_t count) {
+  size_t capacity = state.jobs;
+  for (size_t i = 0; i < workers.length; i++) {
+    capacity += VecAt(workers, i)->slots;
+  }
+
+  Process *running = malloc(sizeof(Process) * capacity);
+  size_t *runningJobs = malloc(sizeof(size_t) * capacity);
+  Worker **runningWorkers = malloc(sizeof(Worker *) * capacity);
+  i64 *startTimes = malloc(sizeof(i64) * capacity);
+  size_t next = 0;
+  size_t active = 0;
+  size_t localActive = 0;
+  errno_t result = SUCCESS;
+
+  while (true) {
+    while (result == SUCCESS && next < count) {
+      BuildJob *job = jobs[next];
+      Worker *worker = StrIsNull(&job->remoteFlags) ? NULL : pickWorker();
+      if (worker == NULL && localActive >= (size_t)state.jobs) {
+        break;
+      }
+
+      errno_t err;
+      if (worker != NULL) {
+        LogInfo("[%zu/%zu] %s: %s", next + 1, count, worker->address.data, job->output.data);
+        err = startRemoteCompile(job, worker, &running[active]);
+      } else {
+        LogInfo("[%zu/%zu] %s", next + 1, count, job->command.data);
+        err = ProcessSpawn(job->command, &running[active]);
+      }
+
+      // NOTE: A job that couldn't start failed like one that exited with an error, the running ones are still waited for
+      if (err != SUCCESS) {
+        result = PROCESS_SPAWN_FAILED;
+        next++;
+        break;
+      }
+
+      if (worker != NULL) {
+        worker->running++;
+      } else {
+        localActive++;
+      }
+      runningWorkers[active] = worker;
+      startTimes[active] = TimeNow();
+      runningJobs[active++] = next++;
+    }
+
+    if (active == 0) {
+      break;
+    }
+
+    size_t finished;
+    if (ProcessWait(running, active, &finished) != SUCCESS) {
+      result = PROCESS_WAIT_FAILED;
+      break;
+    }
+
+    BuildJob *job = jobs[runningJobs[finished]];
+    TraceSpan span = {
+        .output = job->output,
+        .kind = job->kind,
+        .lane = runningWorkers[finished] == NULL ? S("local") : runningWorkers[finished]->address,
+        .start = startTimes[finished] - state.startTime,
+        .end = TimeNow() - state.startTime,
+        .cpuTime = running[finished].cpuTime,
+        .peakMemory = running[finished].peakMemory,
+    };
+    recordSpan(span);
+
+    if (running[finished].exitCode != 0) {
+      LogError("Command failed with code %d: %s", running[finished].exitCode, job->command.data);
+      result = running[finished].exitCode;
+    } else {
+      job->succeeded = true;
+    }
+
+    if (runningWorkers[finished] != NULL) {
+      runningWorkers[finished]->running--;
+    } else {
+      localActive--;
+    }
+
+    active--;
+    running[finished] = running[active];
+    runningJobs[finished] = runningJobs[active];
+    runningWorkers[finished] = runningWorkers[active];
+    startTimes[finished] = startTimes[active];
+  }
+
+  free(running);
+  free(runningJobs);
+  free(runningWorkers);
+  free(startTimes);
+  return result;
+}
+
+static void writeFileIfChanged(String path, String content) {
+  String current = {0};
+  bool unchanged = FileRead(&path, &current) == SUCCESS && StrEqual(current, content);
+  FileFreeContent(current);
+  if (!unchanged) {
+    FileWrite(&path, &content);
+  }
+}
+
+// NOTE: Collects the includes of the leading preprocessor block, quoted ones are resolved next to the source
+static StringVector scanIncludes(String source) {
+  StringVector result = {0};
+  String content = {0};
+  if (FileRead(&source, &content) != SUCCESS) {
+    return result;
+  }
+
+  size_t directoryLength = source.length;
+  while (directoryLength > 0 && source.data[directoryLength - 1] != '/' && source.data[directoryLength - 1] != '\\') {
+    directoryLength--;
+  }
+
+  bool inComment = false;
+  char *line = content.data;
+  while (line != NULL && *line != '\0') {
+    char *end = strchr(line, '\n');
+    char *curr = line;
+    while (*curr == ' ' || *curr == '\t') {
+      curr++;
+    }
+
+    if (inComment || strncmp(curr, "/*", 2) == 0) {
+      char *close = strstr(curr, "*/");
+      inComment = close == NULL || (end != NULL && close > end);
+    } else if (*curr == '#') {
+      curr++;
+      while (*curr == ' ' || *curr == '\t') {
+        curr++;
+      }
+      if (strncmp(curr, "include", 7) == 0) {
+        curr += 7;
+        while (*curr == ' ' || *curr == '\t') {
+          curr++;
+        }
+        char close = *curr == '<' ? '>' : '"';
+        char *last = (*curr == '<' || *curr == '"') ? strchr(curr + 1, close) : NULL;
+        if (last != NULL && (end == NULL || last < end)) {
+          String header = StrNewSize(curr + 1, last - curr - 1);
+          String resolved = FormatMalloc("%.*s%s", (int)directoryLength, source.data, header.data);
+          i64 modifyTime;
+          if (close == '>') {
+            VecPush(result, FormatMalloc("<%s>", header.data));
+          } else if (FileModifyTime(&resolved, &modifyTime) == SUCCESS) {
+            VecPush(result, FormatMalloc("\"%s\"", resolved.data));
+          }
+          StrFree(header);
+          StrFree(resolved);
+        }
+      }
+    } else if (*curr != '\n' && *curr != '\r' && *curr != '\0' && strncmp(curr, "//", 2) != 0) {
+      break; // NOTE: First line of code, later includes may depend on it
+    }
+
+    line = end == NULL ? NULL : end + 1;
+  }
+
+  FileFreeContent(content);
+  return result;
+}
+
+static Executable *findTarget(String name) {
+  for (size_t i = 0; i < targets.length; i++) {
+    if (StrEqual(VecAt(targets, i)->name, name)) {
+      return VecAt(targets, i);
+    }
+  }
+  return NULL;
+}
+
+static String targetFlags(Executable *target) {
+  return profileFlags.length == 0 ? target->flags : FormatMalloc("%s %s", target->flags.data, profileFlags.data);
+}
+
+static String targetLinkerFlags(Executable *target) {
+  String result = target->linkerFlags;
+  if (!StrIsNull(&target->exportsFile)) {
+#ifdef PLATFORM_WIN
+    result = FormatMalloc("%s %s", result.data, target->exportsFile.data);
+#else
+    result = FormatMalloc("%s -Wl,--version-script=%s", result.data, target->exportsFile.data);
+#endif
+  }
+
+  // NOTE: The ThinLTO cache keeps the per-module code generation of unchanged modules between links
+  if (!StrIsNull(&target->lto)) {
+    i32 jobs = target->ltoJobs > 0 ? target->ltoJobs : state.jobs;
+    if (!usesClang()) {
+      result = FormatMalloc("%s -flto=%d", result.data, jobs);
+    } else if (StrEqual(target->lto, S("thin"))) {
+      String cache = FixPath(FormatMalloc("%s/thinlto", state.buildDirectory.data));
+      result = FormatMalloc("%s -Wl,-plugin-opt=jobs=%d -Wl,-plugin-opt=cache-dir=%s", result.data, jobs, cache.data);
+    }
+  }
+
+#ifndef PLATFORM_WIN
+  for (size_t i = 0; i < target->dependencies.length; i++) {
+    if (findTarget(*VecAt(target->dependencies, i))->kind == TARGET_SHARED_LIBRARY) {
+      result = FormatMalloc("%s -Wl,-rpath,%s", result.data, FixPath(state.buildDirectory).data);
+      break;
+    }
+  }
+#endif
+  return result;
+}
+
+// NOTE: Libraries of the graph go first, they usually need the system libraries after them
+static String targetLibs(Executable *target) {
+  String result = S("");
+  for (size_t i = 0; i < target->dependencies.length; i++) {
+    result = FormatMalloc("%s%s ", result.data, findTarget(*VecAt(target->dependencies, i))->path.data);
+  }
+  return FormatMalloc("%s%s", result.data, target->libs.data);
+}
+
+// NOTE: Headers included by at least half of the sources, in the order they were first seen
+static String autoPrecompiledHeader() {
+  StringVector headers = {0};
+  u64 *counts = NULL;
+  u64 *lastSeen = NULL;
+
+  for (size_t i = 0; i < executable.sources.length; i++) {
+    StringVector includes = scanIncludes(*VecAt(executable.sources, i));
+    for (size_t j = 0; j < includes.length; j++) {
+      String include = *VecAt(includes, j);
+      size_t index = 0;
+      while (index < headers.length && !StrEqual(*VecAt(headers, index), include)) {
+        index++;
+      }
+
+      if (index == headers.length) {
+        VecPush(headers, include);
+        counts = realloc(counts, sizeof(u64) * headers.capacity);
+        lastSeen = realloc(lastSeen, sizeof(u64) * headers.capacity);
+        counts[index] = 0;
+        lastSeen[index] = i + 1;
+      } else if (lastSeen[index] == i + 1) {
+        continue;
+      }
+
+      lastSeen[index] = i + 1;
+      counts[index]++;
+    }
+  }
+
+  String content = S("");
+  for (size_t i = 0; i < headers.length; i++) {
+    if (counts[i] < 2 || counts[i] * 2 < executable.sources.length) {
+      continue;
+    }
+    LogInfo("Precompiling %s, included by %llu/%llu sources", VecAt(headers, i)->data, (unsigned long long)counts[i], (unsigned long long)executable.sources.length);
+    content = FormatMalloc("%s#include %s\n", content.data, VecAt(headers, i)->data);
+  }
+
+  free(counts);
+  free(lastSeen);
+  return content;
+}
+
+// NOTE: Targets with the same flags and header content share one precompiled header
+static void preparePrecompiledHeader() {
+  executable.pchInclude = S("");
+  executable.pchOutput = (String){0};
+  if (StrIsNull(&executable.precompiledHeader)) {
+    return;
+  }
+
+  String wrapperName;
+  String content;
+  if (StrEqual(executable.precompiledHeader, S("auto"))) {
+    content = autoPrecompiledHeader();
+    if (content.length == 0) {
+      LogInfo("No header is shared by enough sources to precompile");
+      return;
+    }
+    wrapperName = S("bilt_pch.h");
+  } else {
+    String header = FixPath(executable.precompiledHeader);
+    char *name = header.data + header.length;
+    while (name > header.data && name[-1] != '/' && name[-1] != '\\') {
+      name--;
+    }
+    content = FormatMalloc("#include \"%s\"\n", header.data);
+    wrapperName = s(name);
+  }
+
+  String key = FormatMalloc("%s %s %s", executable.flags.data, executable.includes.data, content.data);
+  String pchDirectory = FixPath(FormatMalloc("%s/pch/%08x", state.buildDirectory.data, (u32)hashString(key)));
+  Mkdir(FixPath(FormatMalloc("%s/pch", state.buildDirectory.data)));
+  Mkdir(pchDirectory);
+  StrFree(key);
+
+  // NOTE: The compilers look for `<header>.gch`/`<header>.pch` next to an `-include`d header and fall back to the wrapper
+  String wrapper = FormatMalloc("%s/%s", pchDirectory.data, wrapperName.data);
+  writeFileIfChanged(wrapper, content);
+  executable.pchInclude = FormatMalloc("-include %s", wrapper.data);
+  executable.pchOutput = FormatMalloc("%s.%s", wrapper.data, usesClang() ? "pch" : "gch");
+
+  for (size_t i = 0; i < pchJobs.length; i++) {
+    if (StrEqual(VecAt(pchJobs, i)->output, executable.pchOutput)) {
+      return;
+    }
+  }
+
+  String source = *VecAt(executable.sources, 0);
+  char *language = source.data[source.length - 1] == 'c' && source.data[source.length - 2] == '.' ? "c-header" : "c++-header";
+  BuildJob pchJob = {0};
+  pchJob.output = executable.pchOutput;
+  pchJob.depfile = FormatMalloc("%s.d", pchJob.output.data);
+  pchJob.command = FormatMalloc("%s %s %s -x %s -MMD -MF %s -c %s -o %s", state.compiler.data, targetFlags(&executable).data, executable.includes.data, language, pchJob.depfile.data, wrapper.data, pchJob.output.data);
+  pchJob.target = executable.index;
+  pchJob.kind = "pch";
+  VecPush(pchJob.inputs, wrapper);
+  VecPush(pchJobs, pchJob);
+}
+
+static char *sourceExtension(String source) {
+  char *dot = strrchr(source.data, '.');
+  return dot == NULL ? "" : dot + 1;
+}
+
+static i32 compareSources(const void *a, const void *b) {
+  String *first = (String *)a;
+  String *second = (String *)b;
+  i32 result = strcmp(sourceExtension(*first), sourceExtension(*second));
+  return result != 0 ? result : strcmp(first->data, second->data);
+}
+
+typedef struct {
+  String source;
+  u64 bucket;
+} UnitySource;
+
+static i32 compareUnitySources(const void *a, const void *b) {
+  UnitySource *first = (UnitySource *)a;
+  UnitySource *second = (UnitySource *)b;
+  if (first->bucket != second->bucket) {
+    return first->bucket < second->bucket ? -1 : 1;
+  }
+  return strcmp(first->source.data, second->source.data);
+}
+
+// NOTE: A new bucket count moves almost every source to another batch, so the last one is kept next to the unity files
+// and only replaced once batches average more than twice or less than a quarter of `unityBatch`
+static u64 unityBucketCount(String unityDirectory, char *extension, size_t count) {
+  String path = FormatMalloc("%s/%s_unity_%s.buckets", unityDirectory.data, executable.name.data, extension);
+  String content = {0};
+  u64 bucketCount = 0;
+  if (FileRead(&path, &content) == SUCCESS) {
+    bucketCount = strtoull(content.data, NULL, 10);
+    FileFreeContent(content);
+  }
+
+  u64 batch = (u64)executable.unityBatch;
+  bool powerOfTwo = bucketCount != 0 && (bucketCount & (bucketCount - 1)) == 0;
+  if (!powerOfTwo || count > bucketCount * batch * 2 || count * 4 < bucketCount * batch) {
+    bucketCount = 1;
+    while (bucketCount * batch < count) {
+      bucketCount *= 2;
+    }
+  }
+  writeFileIfChanged(path, FormatMalloc("%llu\n", (unsigned long long)bucketCount));
+  return bucketCount;
+}
+
+// NOTE: A source's batch is picked by the hash of its path, so adding or removing one only changes the batch it lands in.
+// The bucket count is a power of two that keeps batches around `unityBatch` sources, a batch never mixes extensions
+static StringVector unityBatches() {
+  StringVector sorted = {0};
+  for (size_t i = 0; i < executable.sources.length; i++) {
+    VecPush(sorted, *VecAt(executable.sources, i));
+  }
+  qsort(sorted.data, sorted.length, sizeof(String), compareSources);
+
+  String unityDirectory = FixPath(FormatMalloc("%s/unity", state.buildDirectory.data));
+  Mkdir(unityDirectory);
+
+  StringVector result = {0};
+  size_t start = 0;
+  while (start < sorted.length) {
+    char *extension = sourceExtension(*VecAt(sorted, start));
+    size_t end = start;
+    while (end < sorted.length && strcmp(sourceExtension(*VecAt(sorted, end)), extension) == 0) {
+      end++;
+    }
+
+    size_t count = end - start;
+    u64 bucketCount = unityBucketCount(unityDirectory, extension, count);
+
+    UnitySource *sources = malloc(sizeof(UnitySource) * count);
+    for (size_t i = 0; i < count; i++) {
+      String source = *VecAt(sorted, start + i);
+      sources[i] = (UnitySource){source, hashString(source) & (bucketCount - 1)};
+    }
+    qsort(sources, count, sizeof(UnitySource), compareUnitySources);
+
+    size_t i = 0;
+    while (i < count) {
+      u64 bucket = sources[i].bucket;
+      StrBuilder builder = StrBuilderNew(1024);
+      for (; i < count && sources[i].bucket == bucket; i++) {
+        StrBuilderAppendFormat(&builder, "#include \"%s\"\n", sources[i].source.data);
+      }
+      String content = StrBuilderToString(&builder);
+
+      String unityFile = FormatMalloc("%s/%s_unity_%llu.%s", unityDirectory.data, executable.name.data, (unsigned long long)bucket, extension);
+      writeFileIfChanged(unityFile, content);
+      VecPush(result, unityFile);
+    }
+
+    free(sources);
+    start = end;
+  }
+
+  LogInfo("Merged %llu sources into %llu unity files", (unsigned long long)sorted.length, (unsigned long long)result.length);
+  VecFree(sorted);
+  return result;
+}
+
+static void prepareExports() {
+  executable.exportsFile = (String){0};
+  if (executable.kind != TARGET_SHARED_LIBRARY || executable.exports.length == 0) {
+    return;
+  }
+
+  StrBuilder builder = StrBuilderNew(executable.exports.length * 32);
+#ifdef PLATFORM_WIN
+  StrBuilderAppend(&builder, S("EXPORTS\n"));
+  for (size_t i = 0; i < executable.exports.length; i++) {
+    StrBuilderAppendFormat(&builder, "  %s\n", VecAt(executable.exports, i)->data);
+  }
+  executable.exportsFile = FixPath(FormatMalloc("%s/%s.def", state.buildDirectory.data, executable.output.data));
+#else
+  StrBuilderAppend(&builder, S("{\n  global:\n"));
+  for (size_t i = 0; i < executable.exports.length; i++) {
+    StrBuilderAppendFormat(&builder, "    %s;\n", VecAt(executable.exports, i)->data);
+  }
+  StrBuilderAppend(&builder, S("  local: *;\n};\n"));
+  executable.exportsFile = FixPath(FormatMalloc("%s/%s.map", state.buildDirectory.data, executable.output.data));
+#endif
+  String content = StrBuilderToString(&builder);
+  writeFileIfChanged(executable.exportsFile, content);
+}
+
+// NOTE: `ar` keeps members it isn't given again, so the archive is recreated from scratch
+static String archiveCommand(String output, String objects) {
+#ifdef PLATFORM_WIN
+  return FormatMalloc("cmd /c del /f /q %s 2>nul & ar rcsT %s%s", output.data, output.data, objects.data);
+#else
+  return FormatMalloc("rm -f %s && ar rcsT %s%s", output.data, output.data, objects.data);
+#endif
+}
+
+// NOTE: Objects live in a directory per flag set, targets compiling a source with the same flags share its object.
+// The PGO flags stay out of the hash so both passes lay their objects out the same way
+static bool isPathSeparator(char c) {
+  return c == '/' || c == '\\';
+}
+
+// NOTE: Only a whole `..` component climbs out, `src/foo..bar.c` stays in the project
+static bool hasParentComponent(char *path) {
+  for (char *c = path; *c != '\0'; c++) {
+    bool start = c == path || isPathSeparator(c[-1]);
+    if (start && c[0] == '.' && c[1] == '.' && (c[2] == '\0' || isPathSeparator(c[2]))) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// NOTE: Mirrors the source tree so `src/a/util.c` and `src/b/util.c` get their own object, and keeps the extension so
+// `util.c` and `util.cpp` do too. Sources outside the project go under `external/<hash of their directory>`
+static String objectName(String source, String cwd) {
+  bool inProject = source.length > cwd.length + 1 && strncmp(source.data, cwd.data, cwd.length) == 0 && isPathSeparator(source.data[cwd.length]);
+  if (inProject && !hasParentComponent(source.data + cwd.length)) {
+    return FormatMalloc("%s.o", source.data + cwd.length + 1);
+  }
+
+  size_t base = source.length;
+  while (base > 0 && !isPathSeparator(source.data[base - 1])) {
+    base--;
+  }
+  String separator = ConvertPath(SV("/"));
+  return FormatMalloc("external%s%08x%s%s.o", separator.data, (u32)hashBytes(14695981039346656037ULL, source.data, base), separator.data, source.data + base);
+}
+
+// NOTE: Creates the directories of `object` after its first `start` characters, which already exist. Sources come
+// directory by directory, so remembering the last one skips most of the stats
+static void makeObjectDirectory(String object, size_t start) {
+  String last = lastObjectDirectory;
+  size_t end = object.length;
+  while (end > start && !isPathSeparator(object.data[end - 1])) {
+    end--;
+  }
+  if (end <= start + 1 || (!StrIsNull(&last) && last.length == end - 1 && strncmp(last.data, object.data, end - 1) == 0)) {
+    return;
+  }
+
+  String directory = StrNewSize(object.data, end - 1);
+  for (size_t i = start + 1; i <= directory.length; i++) {
+    if (i == directory.length || isPathSeparator(directory.data[i])) {
+      char separator = directory.data[i];
+      directory.data[i] = '\0';
+      Mkdir((String){i, directory.data});
+      directory.data[i] = separator;
+    }
+  }
+  StrFree(last);
+  lastObjectDirectory = directory;
+}
+
+static void collectCompileJobs(StringVector *sources) {
+  String cwd = GetCwd();
+  String flags = targetFlags(&executable);
+  String flagSet = FormatMalloc("%s %s %s", executable.flags.data, executable.includes.data, executable.pchInclude.data);
+  u32 flagSetHash = (u32)hashString(flagSet);
+  String objectDirectory = FormatMalloc("%s/%08x", state.buildDirectory.data, flagSetHash);
+  Mkdir(FixPath(objectDirectory));
+  executable.objects = (StringVector){0};
+
+  // NOTE: Not part of the flag set, turning the trace on or off rebuilds the objects in place
+  String traceFlags = state.timeTrace ? S(" -ftime-trace") : S("");
+  String objectPrefix = FormatMalloc("%s/%s/", cwd.data, objectDirectory.data);
+
+  for (size_t i = 0; i < sources->length; i++) {
+    String sourceFile = *VecAt((*sources), i);
+    String name = objectName(sourceFile, cwd);
+    BuildJob job = {0};
+    job.output = FormatMalloc("%s%s", objectPrefix.data, name.data);
+    makeObjectDirectory(job.output, objectPrefix.length - 1);
+
+    String objectFlags = traceFlags;
+    if (profileMode == PROFILE_GENERATE && !usesClang()) {
+      // NOTE: gcc names the .gcda after the dump directory, pointing it at the optimized pass' object lets -fprofile-use find it
+      i32 directoryLength = (i32)name.length;
+      while (directoryLength > 0 && !isPathSeparator(name.data[directoryLength - 1])) {
+        directoryLength--;
+      }
+      objectFlags = FormatMalloc("-dumpdir %s/%s/%08x/%.*s%s", cwd.data, profileBuildDirectory.data, flagSetHash, directoryLength, name.data, traceFlags.data);
+    }
+    StrFree(name);
+
+    job.depfile = FormatMalloc("%s.d", job.output.data);
+    job.objectFlags = objectFlags;
+    job.command = FormatMalloc("%s %s %s %s %s -MMD -MF %s -c %s -o %s", state.compiler.data, flags.data, executable.includes.data, executable.pchInclude.data, objectFlags.data, job.depfile.data, sourceFile.data, job.output.data);
+    job.preprocessCommand = FormatMalloc("%s %s %s %s -MMD -MF %s -MT %s -E %s -o %s.i", state.compiler.data, flags.data, executable.includes.data, executable.pchInclude.data, job.depfile.data, job.output.data, sourceFile.data, job.output.data);
+    job.remoteFlags = profileMode == PROFILE_NONE && !state.timeTrace ? executable.flags : (String){0}; // NOTE: Profiles and traces only exist on this machine
+    if (executable.splitDwarf) {
+      // NOTE: The .dwo would stay on the worker
+      job.splitDebug = FormatMalloc("%.*s.dwo", (i32)(job.output.length - 2), job.output.data);
+      job.remoteFlags = (String){0};
+    }
+    job.target = executable.index;
+    job.kind = "compile";
+    VecPush(job.inputs, sourceFile);
+    if (!StrIsNull(&executable.pchOutput)) {
+      VecPush(job.inputs, executable.pchOutput);
+    }
+    if (profileMode == PROFILE_USE) {
+      VecPush(job.inputs, profileStamp);
+    }
+    VecPush(compileJobs, job);
+    VecPush(executable.objects, job.output);
+  }
+
+  StrFree(objectPrefix);
+  StrFree(flagSet);
+}
+
+static BuildJob collectLinkJob() {
+  BuildJob link = {0};
+  link.output = executable.path;
+  link.target = executable.index;
+  link.kind = "link";
+  StrBuilder builder = StrBuilderNew(executable.objects.length * 64);
+  for (size_t i = 0; i < executable.objects.length; i++) {
+    String object = *VecAt(executable.objects, i);
+    StrBuilderAppendFormat(&builder, " %s", object.data);
+    VecPush(link.inputs, object);
+  }
+  String objects = StrBuilderToString(&builder);
+
+  if (!StrIsNull(&executable.exportsFile)) {
+    VecPush(link.inputs, executable.exportsFile);
+  }
+
+  for (size_t i = 0; i < executable.dependencies.length; i++) {
+    VecPush(link.inputs, findTarget(*VecAt(executable.dependencies, i))->path);
+  }
+
+  // NOTE: Big targets go past the 128KB a single shell argument may have, gcc and ar read the objects from a response file
+  String responseFile = FormatMalloc("%s.rsp", executable.path.data);
+  if (state.backend == BACKEND_NATIVE) {
+    writeFileIfChanged(responseFile, objects); // NOTE: ninja writes its own from the rule's `rspfile_content`
+    VecPush(link.inputs, responseFile);        // NOTE: Only rewritten when the object list changes, so a removed source relinks
+  }
+  String objectsArgument = FormatMalloc(" @%s", responseFile.data);
+  if (executable.kind == TARGET_STATIC_LIBRARY) {
+    link.command = archiveCommand(executable.path, objectsArgument);
+  } else {
+    link.command = FormatMalloc("%s %s %s -o %s%s %s", state.compiler.data, targetFlags(&executable).data, targetLinkerFlags(&executable).data, executable.path.data, objectsArgument.data, targetLibs(&executable).data);
+  }
+  return link;
+}
+
+static i32 compareJobOutputs(const void *a, const void *b) {
+  return strcmp(((BuildJob *)a)->output.data, ((BuildJob *)b)->output.data);
+}
+
+static void collectJobs() {
+  compileJobs.length = 0;
+  pchJobs.length = 0;
+  linkJobs.length = 0;
+
+  for (size_t i = 0; i < targets.length; i++) {
+    executable = *VecAt(targets, i);
+    executable.path = FixPath(FormatMalloc("%s/%s", state.buildDirectory.data, executable.output.data));
+    StringVector sources = executable.unityBatch > 1 ? unityBatches() : executable.sources;
+
+    prepareExports();
+    preparePrecompiledHeader();
+    collectCompileJobs(&sources);
+    VecPush(linkJobs, collectLinkJob());
+    *VecAt(targets, i) = executable;
+  }
+
+  // NOTE: Drops the objects another target already compiles
+  if (compileJobs.length > 1) {
+    qsort(compileJobs.data, compileJobs.length, sizeof(BuildJob), compareJobOutputs);
+    size_t unique = 1;
+    for (size_t i = 1; i < compileJobs.length; i++) {
+      if (!StrEqual(VecAt(compileJobs, i)->output, VecAt(compileJobs, unique - 1)->output)) {
+        *VecAt(compileJobs, unique) = *VecAt(compileJobs, i);
+        unique++;
+      }
+    }
+    compileJobs.length = unique;
+  }
+}
+
+static bool linksAgainstAny(BuildJob *link, size_t start, size_t end) {
+  for (size_t i = start; i < end; i++) {
+    for (size_t j = 0; j < link->inputs.length; j++) {
+      if (StrEqual(*VecAt(link->inputs, j), VecAt(linkJobs, i)->output)) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+// NOTE: Runs the dirty jobs in `jobs`, returns how many there were in `ran`
+static errno_t runDirtyJobs(BuildJob *jobs, size_t count, StringVector *log, size_t *ran) {
+  BuildJob **dirtyJobs = malloc(sizeof(BuildJob *) * (count + 1));
+  size_t dirtyCount = 0;
+  for (size_t i = 0; i < count; i++) {
+    BuildJob *job = &jobs[i];
+    if (job->succeeded) {
+      continue; // NOTE: Restored from the compile cache
+    }
+
+    if (isJobDirty(job, log)) {
+      dirtyJobs[dirtyCount++] = job;
+    } else {
+      job->succeeded = true;
+    }
+  }
+
+  errno_t result = runJobs(dirtyJobs, dirtyCount);
+  *ran += dirtyCount;
+  free(dirtyJobs);
+  return result;
+}
+
+static errno_t nativeBackend() {
+  StringVector log = readNativeLog();
+  size_t ran = 0;
+
+  // NOTE: Precompiled headers go first, the compile jobs depend on them
+  errno_t result = runDirtyJobs(pchJobs.data, pchJobs.length, &log, &ran);
+  if (result == SUCCESS) {
+    result = runDirtyJobs(compileJobs.data, compileJobs.length, &log, &ran);
+  }
+
+  // NOTE: Links run in waves, a target waits for the targets it links against
+  size_t start = 0;
+  while (result == SUCCESS && start < linkJobs.length) {
+    size_t end = start + 1;
+    while (end < linkJobs.length && !linksAgainstAny(VecAt(linkJobs, end), start, end)) {
+      end++;
+    }
+    result = runDirtyJobs(linkJobs.data + start, end - start, &log, &ran);
+    start = end;
+  }
+
+  if (result == SUCCESS && ran == 0) {
+    LogInfo("No work to do");
+  }
+
+  BuildJobVector allJobs = {0};
+  for (size_t i = 0; i < pchJobs.length; i++) {
+    VecPush(allJobs, *VecAt(pchJobs, i));
+  }
+  for (size_t i = 0; i < compileJobs.length; i++) {
+    VecPush(allJobs, *VecAt(compileJobs, i));
+  }
+  for (size_t i = 0; i < linkJobs.length; i++) {
+    VecPush(allJobs, *VecAt(linkJobs, i));
+  }
+  writeNativeLog(&allJobs);
+
+  VecFree(allJobs);
+  return result;
+}
+
+static String compilerIdentity() {
+  if (!StrIsNull(&compilerIdentityCache)) {
+    return compilerIdentityCache;
+  }
+
+  String identity = FormatMalloc("%s\n", state.compiler.data);
+  FILE *pipe = popen(FormatMalloc("%s --version", state.compiler.data).data, "r");
+  if (pipe == NULL) {
+    compilerIdentityCache = identity;
+    return identity;
+  }
+
+  char buffer[1024];
+  size_t bytesRead;
+  while ((bytesRead = fread(buffer, 1, sizeof(buffer), pipe)) > 0) {
+    String chunk = StrNewSize(buffer, bytesRead);
+    identity = StrConcat(&identity, &chunk);
+    StrFree(chunk);
+  }
+  pclose(pipe);
+  compilerIdentityCache = identity;
+  return identity;
+}
+
+#define COMPILE_CACHE_ROOT "$BILT_ROOT/" // NOTE: Stands in for the working directory in cached depfiles
+
+// NOTE: Every `from` in `text` becomes `to`
+static String replaceAll(String text, String from, String to) {
+  StrBuilder builder = StrBuilderNew(text.length + 1);
+  size_t start = 0;
+  while (start < text.length) {
+    size_t found = start + StrScanNeedle(text.data + start, text.length - start, from.data, from.length);
+    StrBuilderAppend(&builder, (String){.length = found - start, .data = text.data + start});
+    if (found == text.length) {
+      break;
+    }
+    StrBuilderAppend(&builder, to);
+    start = found + from.length;
+  }
+  return StrBuilderToString(&builder);
+}
+
+// NOTE: The working directory with a trailing separator, what gets swapped out so other checkouts share entries
+static String compileCacheRoot() {
+  return FormatMalloc("%s%s", GetCwd().data, ConvertPath(SV("/")).data);
+}
+
+// NOTE: Two differently seeded hashes of the compiler, command and preprocessed source make the 128 bit key. The
+// output and depfile arguments and the working directory are left out of it so the same tree in another checkout hits
+static String compileCacheEntry(BuildJob *job, String preprocessed) {
+  String identity = compilerIdentity();
+  String root = compileCacheRoot();
+  String command = replaceAll(job->command, job->output, S(""));
+  command = replaceAll(command, job->depfile, S(""));
+  command = replaceAll(command, root, S(""));
+  String source = replaceAll(preprocessed, root, S(""));
+
+  u64 seeds[] = {14695981039346656037ULL, 0x9e3779b97f4a7c15ULL};
+  u64 keys[2];
+  for (size_t i = 0; i < 2; i++) {
+    keys[i] = hashBytes(seeds[i], identity.data, identity.length);
+    keys[i] = hashBytes(keys[i], command.data, command.length + 1);
+    keys[i] = hashBytes(keys[i], source.data, source.length);
+  }
+  StrFree(source);
+  StrFree(command);
+  StrFree(root);
+
+  String directory = FormatMalloc("%s/%02x", state.compileCache.data, (u32)(keys[0] >> 56));
+  Mkdir(state.compileCache);
+  Mkdir(directory);
+  String entry = FormatMalloc("%s/%016llx%016llx", directory.data, (unsigned long long)keys[0], (unsigned long long)keys[1]);
+  StrFree(directory);
+  return entry;
+}
+
+// NOTE: A non null `from` is replaced by `to` in the copy, depfiles keep the working directory out of the cache that way
+static bool copyFile(String source, String destination, String from, String to) {
+  String content = {0};
+  if (FileRead(&source, &content) != SUCCESS) {
+    return false;
+  }
+
+  String copy = StrIsNull(&from) ? content : replaceAll(content, from, to);
+  errno_t err = FileWrite(&destination, &copy);
+  if (copy.data != content.data) {
+    StrFree(copy);
+  }
+  FileFreeContent(content);
+  return err == SUCCESS;
+}
+
+// NOTE: Other bilt processes may read the entry at any time, so it only appears through a rename
+static void publishFile(String source, String destination, String from, String to) {
+  String temporary = FormatMalloc("%s.%d.tmp", destination.data, (i32)getpid());
+  if (copyFile(source, temporary, from, to) && rename(temporary.data, destination.data) != 0) {
+    remove(temporary.data); // NOTE: Someone else published it first
+  }
+  StrFree(temporary);
+}
+
+// NOTE: Preprocesses every out of date object and restores the ones the cache already has
+static void restoreFromCompileCache() {
+  StringVector log = readNativeLog();
+  BuildJob **candidates = malloc(sizeof(BuildJob *) * compileJobs.length);
+  BuildJob *preprocessJobs = calloc(compileJobs.length, sizeof(BuildJob));
+  BuildJob **preprocessQueue = malloc(sizeof(BuildJob *) * compileJobs.length);
+  size_t count = 0;
+
+  for (size_t i = 0; i < compileJobs.length; i++) {
+    BuildJob *job = VecAt(compileJobs, i);
+    if (!isJobDirty(job, &log)) {
+      continue;
+    }
+
+    BuildJob *preprocess = &preprocessJobs[count];
+    preprocess->output = FormatMalloc("%s.i", job->output.data);
+    preprocess->command = job->preprocessCommand;
+    preprocess->kind = "preprocess";
+    preprocessQueue[count] = preprocess;
+    candidates[count++] = job;
+  }
+
+  if (count > 0) {
+    runJobs(preprocessQueue, count); // NOTE: Failures show up again when compiling
+  }
+
+  size_t hits = 0;
+  String root = compileCacheRoot();
+  for (size_t i = 0; i < count; i++) {
+    BuildJob *job = candidates[i];
+    String preprocessed = {0};
+    if (!preprocessJobs[i].succeeded || FileRead(&preprocessJobs[i].output, &preprocessed) != SUCCESS) {
+      continue;
+    }
+    remove(preprocessJobs[i].output.data);
+
+    String entry = compileCacheEntry(job, preprocessed);
+    String object = FormatMalloc("%s.o", entry.data);
+    String depfile = FormatMalloc("%s.d", entry.data);
+    FileFreeContent(preprocessed);
+
+    String splitDebug = FormatMalloc("%s.dwo", entry.data);
+    bool restored = copyFile(object, job->output, (String){0}, (String){0}) && copyFile(depfile, job->depfile, S(COMPILE_CACHE_ROOT), root);
+    if (restored && !StrIsNull(&job->splitDebug)) {
+      restored = copyFile(splitDebug, job->splitDebug, (String){0}, (String){0});
+    }
+    StrFree(splitDebug);
+
+    if (restored) {
+      FileTouch(&object);
+      FileTouch(&depfile);
+      job->succeeded = true;
+      hits++;
+    } else {
+      job->cacheEntry = entry;
+    }
+    StrFree(object);
+    StrFree(depfile);
+  }
+
+  if (count > 0) {
+    LogInfo("Compile cache: %zu hits, %zu misses", hits, count - hits);
+  }
+  StrFree(root);
+  free(candidates);
+  free(preprocessJobs);
+  free(preprocessQueue);
+}
+
+static i32 compareFileTimes(const void *a, const void *b) {
+  i64 first = ((File *)a)->modifyTime;
+  i64 second = ((File *)b)->modifyTime;
+  return (first > second) - (first < second);
+}
+
+// NOTE: Least recently used goes first, hits refresh the modify time of an entry
+static void evictCompileCache() {
+  Folder *root = GetDirFiles(state.compileCache);
+  File *files = NULL;
+  size_t fileCount = 0;
+  i64 totalSize = 0;
+
+  for (size_t i = 0; i < root->folderCount; i++) {
+    Folder *folder = &root->folders[i];
+    files = realloc(files, sizeof(File) * (fileCount + folder->fileCount));
+    for (size_t j = 0; j < folder->fileCount; j++) {
+      File file = folder->files[j];
+      file.name = FormatMalloc("%s/%s", folder->name.data, file.name.data);
+      files[fileCount++] = file;
+      totalSize += file.size;
+    }
+  }
+
+  if (totalSize > state.compileCacheSize) {
+    qsort(files, fileCount, sizeof(File), compareFileTimes);
+    i64 target = state.compileCacheSize / 10 * 9;
+    size_t evicted = 0;
+    for (size_t i = 0; i < fileCount && totalSize > target; i++) {
+      if (remove(files[i].name.data) == 0) {
+        totalSize -= files[i].size;
+        evicted++;
+      }
+    }
+    LogInfo("Compile cache: evicted %zu files", evicted);
+  }
+
+  for (size_t i = 0; i < fileCount; i++) {
+    StrFree(files[i].name);
+  }
+  free(files);
+  FreeFolder(root);
+}
+
+static void storeInCompileCache() {
+  String root = compileCacheRoot();
+  size_t stored = 0;
+  for (size_t i = 0; i < compileJobs.length; i++) {
+    BuildJob *job = VecAt(compileJobs, i);
+    i64 modifyTime;
+    if (StrIsNull(&job->cacheEntry) || FileModifyTime(&job->output, &modifyTime) != SUCCESS) {
+      continue;
+    }
+
+    // NOTE: Depfile first, a lookup needs both and checks the object first
+    publishFile(job->depfile, FormatMalloc("%s.d", job->cacheEntry.data), root, S(COMPILE_CACHE_ROOT));
+    if (!StrIsNull(&job->splitDebug)) {
+      publishFile(job->splitDebug, FormatMalloc("%s.dwo", job->cacheEntry.data), (String){0}, (String){0});
+    }
+    publishFile(job->output, FormatMalloc("%s.o", job->cacheEntry.data), (String){0}, (String){0});
+    stored++;
+  }
+
+  StrFree(root);
+  if (stored > 0) {
+    evictCompileCache();
+  }
+}
+
+// NOTE: Hash of the last manifest ninja built successfully, kept next to each build.ninja since PGO builds have one
+// manifest per build directory
+static String graphHashPath(String buildNinjaPath) {
+  return FormatMalloc("%s.hash", buildNinjaPath.data);
+}
+
+static u64 readGraphHash(String buildNinjaPath) {
+  String path = graphHashPath(buildNinjaPath);
+  String content = {0};
+  u64 result = 0;
+  if (FileRead(&path, &content) == SUCCESS) {
+    result = strtoull(content.data, NULL, 16);
+    FileFreeContent(content);
+  }
+  return result;
+}
+
+static void writeGraphHash(String buildNinjaPath, u64 graphHash) {
+  String path = graphHashPath(buildNinjaPath);
+  String content = FormatMalloc("%016llx\n", (unsigned long long)graphHash);
+  FileWrite(&path, &content);
+}
+
+// NOTE: Only a stat pass, commands are covered by the manifest hash
+static bool isGraphStale() {
+  BuildJobVector *groups[] = {&pchJobs, &compileJobs, &linkJobs};
+  for (size_t i = 0; i < sizeof(groups) / sizeof(groups[0]); i++) {
+    for (size_t j = 0; j < groups[i]->length; j++) {
+      if (isJobStale(VecAt((*groups[i]), j))) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+// NOTE: Picks up the entries this run appended, ninja logs times relative to its own start and no resource usage.
+// When ninja recompacted the log it's shorter than `offset` and the old entries come along
+static void readNinjaLog(String path, size_t offset, i64 ninjaStart) {
+  String content = {0};
+  if (FileRead(&path, &content) != SUCCESS) {
+    return;
+  }
+
+  JobMap jobs = {0};
+  BuildJobVector *groups[] = {&pchJobs, &compileJobs, &linkJobs};
+  for (size_t i = 0; i < sizeof(groups) / sizeof(groups[0]); i++) {
+    for (size_t j = 0; j < groups[i]->length; j++) {
+      JobMapInsert(&jobs, VecAt((*groups[i]), j)->output, VecAt((*groups[i]), j));
+    }
+  }
+
+  String newline = S("\n");
+  String entries = content.length >= offset ? s(content.data + offset) : content;
+  // NOTE: Lines and fields point into `content`, strtoll stops at the tab after the times
+  StringVector lines = StrSplitView(&entries, &newline);
+  for (size_t i = 0; i < lines.length; i++) {
+    String line = *VecAt(lines, i);
+    if (line.length == 0 || line.data[0] == '#') {
+      continue;
+    }
+
+    String tab = S("\t");
+    StringVector fields = StrSplitView(&line, &tab);
+    if (fields.length < 4) {
+      VecFree(fields);
+      continue;
+    }
+
+    String output = *VecAt(fields, 3);
+    BuildJob **job = JobMapFind(&jobs, output);
+    TraceSpan span = {
+        .output = StrNewSize(output.data, output.length),
+        .kind = job == NULL ? "other" : (*job)->kind,
+        .lane = S("ninja"),
+        .start = ninjaStart + strtoll(VecAt(fields, 0)->data, NULL, 10),
+        .end = ninjaStart + strtoll(VecAt(fields, 1)->data, NULL, 10),
+        .cpuTime = -1,
+        .peakMemory = -1,
+    };
+    recordSpan(span);
+    VecFree(fields);
+  }
+
+  if (lines.data != NULL) {
+    VecFree(lines);
+  }
+  JobMapFree(&jobs);
+  FileFreeContent(content);
+}
+
+static errno_t ninjaBackend() {
+  String cwd = GetCwd();
+  // NOTE: No `deps = gcc`, the depfiles are kept around for bilt's own stat pass
+  // NOTE: The whole manifest goes through one builder in a single pass, it's megabytes for big projects
+  StrBuilder manifest = StrBuilderNew(64 * 1024);
+  StrBuilderAppendFormat(&manifest,
+                         "cc = %s\n"
+                         "cwd = %s\n"
+                         "builddir = $cwd/%s\n"
+                         "\n"
+                         "rule link\n"
+                         "  command = $cc $flags $linker_flags -o $out @$out.rsp $libs\n"
+                         "  rspfile = $out.rsp\n"
+                         "  rspfile_content = $in\n"
+                         "\n"
+                         "rule archive\n"
+                         "  command = %s\n"
+                         "  rspfile = $out.rsp\n"
+                         "  rspfile_content = $in\n"
+                         "\n"
+                         "rule compile\n"
+                         "  command = $cc $flags $includes $pch_include $object_flags -MMD -MF $out.d -c $in -o $out\n"
+                         "  depfile = $out.d\n"
+                         "\n"
+                         "rule pch\n"
+                         "  command = $pch_command\n"
+                         "  depfile = $out.d\n"
+                         "\n",
+                         state.compiler.data,
+                         ConvertNinjaPath(StrNew(cwd.data)).data,
+                         state.buildDirectory.data,
+                         archiveCommand(S("$out"), S(" @$out.rsp")).data);
+
+  // NOTE: Every target gets its own copy of the variables, edges pick theirs by index
+  for (size_t i = 0; i < targets.length; i++) {
+    Executable *target = VecAt(targets, i);
+    StrBuilderAppendFormat(&manifest,
+                           "flags_%zu = %s\n"
+                           "includes_%zu = %s\n"
+                           "pch_include_%zu = %s\n"
+                           "linker_flags_%zu = %s\n"
+                           "libs_%zu = %s\n"
+                           "\n",
+                           i, targetFlags(target).data,
+                           i, target->includes.data,
+                           i, target->pchInclude.data,
+                           i, targetLinkerFlags(target).data,
+                           i, targetLibs(target).data);
+  }
+
+  // NOTE: The command is already fully expanded, it only runs once per flag set
+  for (size_t i = 0; i < pchJobs.length; i++) {
+    BuildJob *job = VecAt(pchJobs, i);
+    StrBuilderAppendFormat(&manifest,
+                           "build %s: pch %s\n"
+                           "  pch_command = %s\n"
+                           "\n",
+                           ConvertNinjaPath(job->output).data,
+                           ConvertNinjaPath(*VecAt(job->inputs, 0)).data,
+                           job->command.data);
+  }
+
+  for (size_t i = 0; i < compileJobs.length; i++) {
+    BuildJob *job = VecAt(compileJobs, i);
+    StrBuilderAppendFormat(&manifest, "build %s: compile %s", ConvertNinjaPath(job->output).data, ConvertNinjaPath(*VecAt(job->inputs, 0)).data);
+    for (size_t j = 1; j < job->inputs.length; j++) {
+      StrBuilderAppendFormat(&manifest, "%s %s", j == 1 ? " |" : "", ConvertNinjaPath(*VecAt(job->inputs, j)).data);
+    }
+    StrBuilderAppendFormat(&manifest,
+                           "\n"
+                           "  flags = $flags_%zu\n"
+                           "  includes = $includes_%zu\n"
+                           "  pch_include = $pch_include_%zu\n"
+                           "  object_flags = %s\n",
+                           job->target,
+                           job->target,
+                           job->target,
+                           job->objectFlags.data);
+  }
+
+  StrBuilder defaults = StrBuilderNew(256);
+  StrBuilderAppend(&defaults, S("default"));
+  for (size_t i = 0; i < linkJobs.length; i++) {
+    BuildJob *job = VecAt(linkJobs, i);
+    Executable *target = VecAt(targets, job->target);
+    StrBuilderAppendFormat(&manifest, "\nbuild %s: %s", ConvertNinjaPath(job->output).data, target->kind == TARGET_STATIC_LIBRARY ? "archive" : "link");
+    for (size_t j = 0; j < target->objects.length; j++) {
+      StrBuilderAppendFormat(&manifest, " %s", ConvertNinjaPath(*VecAt(target->objects, j)).data);
+    }
+    for (size_t j = target->objects.length; j < job->inputs.length; j++) {
+      StrBuilderAppendFormat(&manifest, "%s %s", j == target->objects.length ? " |" : "", ConvertNinjaPath(*VecAt(job->inputs, j)).data);
+    }
+    StrBuilderAppendFormat(&manifest,
+                           "\n"
+                           "  flags = $flags_%zu\n"
+                           "  linker_flags = $linker_flags_%zu\n"
+                           "  libs = $libs_%zu\n",
+                           job->target,
+                           job->target,
+                           job->target);
+    StrBuilderAppendFormat(&defaults, " %s", ConvertNinjaPath(job->output).data);
+  }
+  StrBuilderAppendFormat(&manifest, "\n%s\n", defaults.data);
+  StrBuilderFree(&defaults);
+  String ninjaOutput = StrBuilderToString(&manifest);
+
+  String relativeBuildPath = FormatMalloc("%s/build.ninja", state.buildDirectory.data);
+  String buildNinjaPath = FixPath(relativeBuildPath);
+
+  u64 graphHash = hashString(ninjaOutput);
+  state.graphTime = TimeNow() - state.startTime;
+  i64 manifestTime;
+  if (graphHash != readGraphHash(buildNinjaPath) || FileModifyTime(&buildNinjaPath, &manifestTime) != SUCCESS) {
+    FileWrite(&buildNinjaPath, &ninjaOutput);
+  } else if (!isGraphStale()) {
+    LogInfo("No work to do");
+    return SUCCESS;
+  }
+
+  String ninjaLogPath = FixPath(FormatMalloc("%s/.ninja_log", state.buildDirectory.data));
+  String ninjaLog = {0};
+  i64 logTime;
+  if (FileModifyTime(&ninjaLogPath, &logTime) == SUCCESS) {
+    FileRead(&ninjaLogPath, &ninjaLog);
+  }
+
+  i64 ninjaStart = TimeNow();
+  errno_t result = RunCommand(FormatMalloc("ninja -j %d -f %s", state.jobs, buildNinjaPath.data));
+  readNinjaLog(ninjaLogPath, ninjaLog.length, ninjaStart - state.startTime);
+  FileFreeContent(ninjaLog);
+  if (result == SUCCESS) {
+    writeGraphHash(buildNinjaPath, graphHash);
+  }
+  return result;
+}
+
+String AddTarget() {
+  if (executable.sources.length == 0) {
+    LogError("Target %s has zero sources, add at least one with AddFile(\"./main.c\")", executable.name.data);
+    abort();
+  }
+
+  executable.path = FixPath(FormatMalloc("%s/%s", state.buildDirectory.data, executable.output.data));
+  if (executable.index != TARGET_NOT_ADDED) {
+    *VecAt(targets, executable.index) = executable;
+    return executable.path;
+  }
+
+  for (size_t i = 0; i < targets.length; i++) {
+    if (StrEqual(VecAt(targets, i)->path, executable.path)) {
+      LogError("Target %s was already added", executable.path.data);
+      abort();
+    }
+  }
+
+  executable.index = targets.length;
+  VecPush(targets, executable);
+  return executable.path;
+}
+
+// NOTE: The compile cache key doesn't cover the profile, optimized objects skip it
+typedef struct {
+  char *section;
+  String detail;
+  i64 duration; // NOTE: Microseconds
+  i32 count;
+} TimeTraceEntry;
+
+VEC_TYPE(TimeTraceEntryVector, TimeTraceEntry);
+
+// NOTE: Events of one translation unit nest, a header's time includes the headers it includes
+static struct {
+  char *event;
+  char *section;
+} timeTraceEvents[] = {
+    {"Source", "Headers"},
+    {"InstantiateClass", "Templates"},
+    {"InstantiateFunction", "Templates"},
+    {"ParseFunctionDefinition", "Functions"},
+    {"CodeGen Function", "Functions"},
+};
+
+static char *timeTraceSections[] = {"Headers", "Templates", "Functions"};
+
+// NOTE: Enough JSON for what -ftime-trace writes, `"key":` followed by a string or a number
+static String jsonField(char *start, char *end, char *key) {
+  String pattern = FormatMalloc("\"%s\":", key);
+  char *match = start;
+  while (match + pattern.length <= end && strncmp(match, pattern.data, pattern.length) != 0) {
+    match++;
+  }
+  if (match + pattern.length > end) {
+    StrFree(pattern);
+    return (String){0};
+  }
+
+  char *value = match + pattern.length;
+  StrFree(pattern);
+  while (value < end && *value == ' ') {
+    value++;
+  }
+
+  if (value < end && *value != '"') {
+    char *valueEnd = value;
+    while (valueEnd < end && (isdigit(*valueEnd) || *valueEnd == '-' || *valueEnd == '.')) {
+      valueEnd++;
+    }
+    return StrNewSize(value, valueEnd - value);
+  }
+
+  char *valueEnd = value + 1;
+  while (valueEnd < end && *valueEnd != '"') {
+    valueEnd += *valueEnd == '\\' ? 2 : 1;
+  }
+
+  String result = StrNewSize(value + 1, valueEnd - value - 1);
+  size_t length = 0;
+  for (size_t i = 0; i < result.length; i++) {
+    if (result.data[i] == '\\') {
+      i++; // NOTE: Paths and template names only escape quotes and backslashes
+    }
+    result.data[length++] = result.data[i];
+  }
+  result.data[length] = '\0';
+  result.length = length;
+  return result;
+}
+
+static void collectTimeTrace(String trace, TimeTraceEntryVector *entries, i64 *frontendTime) {
+  char *events = strstr(trace.data, "\"traceEvents\"");
+  if (events == NULL || (events = strchr(events, '[')) == NULL) {
+    return;
+  }
+
+  i32 depth = 0;
+  bool quoted = false;
+  char *eventStart = NULL;
+  for (char *c = events + 1; *c != '\0' && (depth > 0 || *c != ']'); c++) {
+    if (quoted) {
+      if (*c == '\\' && c[1] != '\0') {
+        c++;
+      } else if (*c == '"') {
+        quoted = false;
+      }
+      continue;
+    }
+
+    if (*c == '"') {
+      quoted = true;
+    } else if (*c == '{' && depth++ == 0) {
+      eventStart = c;
+    } else if (*c == '}' && --depth == 0) {
+      String name = jsonField(eventStart, c, "name");
+      String duration = jsonField(eventStart, c, "dur");
+      if (StrIsNull(&name) || StrIsNull(&duration)) {
+        continue;
+      }
+
+      if (StrEqual(name, S("Total Frontend"))) {
+        *frontendTime += strtoll(duration.data, NULL, 10);
+      }
+      for (size_t i = 0; i < sizeof(timeTraceEvents) / sizeof(timeTraceEvents[0]); i++) {
+        if (!StrEqual(name, s(timeTraceEvents[i].event))) {
+          continue;
+        }
+
+        String detail = jsonField(eventStart, c, "detail");
+        if (!StrIsNull(&detail)) {
+          VecPush((*entries), ((TimeTraceEntry){timeTraceEvents[i].section, detail, strtoll(duration.data, NULL, 10), 1}));
+        }
+        break;
+      }
+      StrFree(name);
+      StrFree(duration);
+    }
+  }
+}
+
+static i32 compareTimeTraceDetails(const void *a, const void *b) {
+  const TimeTraceEntry *first = a;
+  const TimeTraceEntry *second = b;
+  i32 section = strcmp(first->section, second->section);
+  return section != 0 ? section : strcmp(first->detail.data, second->detail.data);
+}
+
+static i32 compareTimeTraceDurations(const void *a, const void *b) {
+  const TimeTraceEntry *first = a;
+  const TimeTraceEntry *second = b;
+  i32 section = strcmp(first->section, second->section);
+  if (section != 0) {
+    return section;
+  }
+  return (first->duration < second->duration) - (first->duration > second->duration);
+}
+
+// NOTE: clang writes the trace of `x.o` to `x.json`, objects that weren't rebuilt still have theirs from the last build
+static void writeTimeTraceReport() {
+  TimeTraceEntryVector entries = {0};
+  i64 frontendTime = 0;
+  size_t units = 0;
+  for (size_t i = 0; i < compileJobs.length; i++) {
+    BuildJob *job = VecAt(compileJobs, i);
+    String tracePath = FormatMalloc("%.*s.json", (i32)(job->output.length - 2), job->output.data);
+    String trace = {0};
+    i64 traceTime;
+    if (FileModifyTime(&tracePath, &traceTime) == SUCCESS && FileRead(&tracePath, &trace) == SUCCESS) {
+      collectTimeTrace(trace, &entries, &frontendTime);
+      FileFreeContent(trace);
+      units++;
+    }
+    StrFree(tracePath);
+  }
+
+  // NOTE: Sorting by detail puts the events of one header or template next to each other to sum them up
+  size_t unique = 0;
+  if (entries.length > 0) {
+    qsort(entries.data, entries.length, sizeof(TimeTraceEntry), compareTimeTraceDetails);
+    for (size_t i = 1; i < entries.length; i++) {
+      TimeTraceEntry *last = VecAt(entries, unique);
+      TimeTraceEntry *entry = VecAt(entries, i);
+      if (compareTimeTraceDetails(last, entry) == 0) {
+        last->duration += entry->duration;
+        last->count++;
+        continue;
+      }
+      unique++;
+      *VecAt(entries, unique) = *entry;
+    }
+    unique++;
+    qsort(entries.data, unique, sizeof(TimeTraceEntry), compareTimeTraceDurations);
+  }
+
+  String reportPath = FixPath(FormatMalloc("%s/time_trace.txt", state.buildDirectory.data));
+  FILE *file = fopen(reportPath.data, "w");
+  if (file == NULL) {
+    LogError("Failed to open output file '%s'", reportPath.data);
+    return;
+  }
+
+  fprintf(file, "%zu translation units, %.1fms in the frontend\n", units, frontendTime / 1000.0);
+  for (size_t i = 0; i < sizeof(timeTraceSections) / sizeof(timeTraceSections[0]); i++) {
+    fprintf(file, "\n%s (total, count)\n", timeTraceSections[i]);
+    size_t printed = 0;
+    for (size_t j = 0; j < unique && printed < 50; j++) {
+      TimeTraceEntry *entry = VecAt(entries, j);
+      if (strcmp(entry->section, timeTraceSections[i]) == 0) {
+        fprintf(file, "%10.1fms %6d  %s\n", entry->duration / 1000.0, entry->count, entry->detail.data);
+        printed++;
+      }
+    }
+  }
+  fclose(file);
+  LogInfo("Time trace report: %s", reportPath.data);
+
+  if (entries.length > 0) {
+    VecFree(entries);
+  }
+}
+
+static void buildTargets() {
+  collectJobs();
+  state.graphTime = TimeNow() - state.startTime;
+  // NOTE: ninja rebuilds an object its .ninja_log doesn't know, so a restore in front of it would be wasted work
+  bool cacheable = !StrIsNull(&state.compileCache) && profileMode != PROFILE_USE && !state.timeTrace;
+  if (cacheable && state.backend != BACKEND_NATIVE) {
+    LogWarn("The compile cache only works with the native backend, ninja builds don't use it");
+    cacheable = false;
+  }
+  if (cacheable) {
+    restoreFromCompileCache();
+  }
+
+  if (state.backend == BACKEND_NATIVE) {
+    errno_t result = nativeBackend();
+    if (result != SUCCESS) {
+      LogError("Native build failed with code: %d", result);
+      abort();
+    }
+    LogSuccess("Native build done");
+  } else {
+    errno_t result = ninjaBackend();
+    if (result != SUCCESS) {
+      LogError("Ninja file compilation failed with code: %d", result);
+      abort();
+    }
+    LogSuccess("Ninja file compilation done");
+  }
+
+  if (cacheable) {
+    storeInCompileCache();
+  }
+
+  if (state.timeTrace) {
+    writeTimeTraceReport();
+  }
+}
+
+// NOTE: Builds every target instrumented under `<build>/pgo`, then runs the training command unless the profile
+// already matches the instrumented binary. The optimized pass that follows reads the profile
+static void trainProfile(size_t current) {
+  bool clang = usesClang();
+  profileBuildDirectory = state.buildDirectory;
+  state.buildDirectory = ConvertPath(StrViewOf(FormatMalloc("%s/pgo", profileBuildDirectory.data)));
+  Mkdir(state.buildDirectory);
+
+  String profileDirectory = FixPath(FormatMalloc("%s/profile", state.buildDirectory.data));
+  String mergedProfile = FormatMalloc("%s/merged.profdata", profileDirectory.data);
+  profileStamp = FixPath(FormatMalloc("%s/profile.stamp", state.buildDirectory.data));
+  profileMode = PROFILE_GENERATE;
+  profileFlags = clang ? FormatMalloc("-fprofile-generate=%s", profileDirectory.data)
+                       : FormatMalloc("-fprofile-generate=%s -fprofile-update=prefer-atomic", profileDirectory.data);
+
+  LogInfo("Building the instrumented binary for PGO");
+  buildTargets();
+  String instrumented = VecAt(targets, current)->path;
+  state.buildDirectory = profileBuildDirectory;
+
+  String key = FormatMalloc("%s %s", state.compiler.data, state.profileTraining.data);
+  u64 profileHash = hashString(key);
+  StrFree(key);
+
+  i64 stampTime;
+  i64 instrumentedTime;
+  bool fresh = state.cache.profileHash == profileHash &&
+               FileModifyTime(&profileStamp, &stampTime) == SUCCESS &&
+               FileModifyTime(&instrumented, &instrumentedTime) == SUCCESS &&
+               stampTime >= instrumentedTime;
+
+  if (fresh) {
+    LogInfo("PGO profile is up to date");
+  } else {
+    // NOTE: Counters of older binaries would be merged into the new ones
+    Mkdir(profileDirectory);
+    Folder *folder = GetDirFiles(profileDirectory);
+    StringVector stale = {0};
+    collectFiles(folder, clang ? "profraw" : "gcda", &stale);
+    FreeFolder(folder);
+    for (size_t i = 0; i < stale.length; i++) {
+      remove(VecAt(stale, i)->data);
+    }
+
+    // NOTE: StrSplit drops a trailing empty part, so a command ending in $exe is substituted by hand
+    String command = S("");
+    char *rest = state.profileTraining.data;
+    for (char *match = strstr(rest, "$exe"); match != NULL; match = strstr(rest, "$exe")) {
+      command = FormatMalloc("%s%.*s%s", command.data, (i32)(match - rest), rest, instrumented.data);
+      rest = match + STRING_LENGTH("$exe");
+    }
+    command = FormatMalloc("%s%s", command.data, rest);
+
+    if (clang) {
+      setenv("LLVM_PROFILE_FILE", FormatMalloc("%s/%%p-%%m.profraw", profileDirectory.data).data, 1);
+    }
+    LogInfo("Training the PGO profile with: %s", command.data);
+    if (RunCommand(command) != SUCCESS) {
+      LogError("PGO training command failed: %s", command.data);
+      abort();
+    }
+
+    if (clang) {
+      StringVector raw = {0};
+      folder = GetDirFiles(profileDirectory);
+      collectFiles(folder, "profraw", &raw);
+      FreeFolder(folder);
+
+      String merge = FormatMalloc("llvm-profdata merge -output=%s", mergedProfile.data);
+      for (size_t i = 0; i < raw.length; i++) {
+        merge = FormatMalloc("%s %s", merge.data, VecAt(raw, i)->data);
+      }
+      if (raw.length == 0 || RunCommand(merge) != SUCCESS) {
+        LogError("Couldn't merge the PGO profile, is llvm-profdata on the PATH?");
+        abort();
+      }
+    }
+
+    String empty = S("");
+    FileWrite(&profileStamp, &empty);
+    state.cache.profileHash = profileHash;
+    writeCache();
+  }
+
+  profileMode = PROFILE_USE;
+  profileFlags = clang ? FormatMalloc("-fprofile-use=%s -Wno-profile-instr-unprofiled -Wno-profile-instr-out-of-date", mergedProfile.data)
+                       : FormatMalloc("-fprofile-use=%s -fprofile-partial-training -Wno-missing-profile", profileDirectory.data);
+}
+
+String InstallExecutable() {
+  AddTarget();
+
+  if (compilerToolchain(state.compiler) == TOOLCHAIN_MSVC) {
+    LogError("MSVC not yet implemented");
+    abort();
+  }
+
+  if (state.workerAddresses.length > 0 && state.backend == BACKEND_NINJA) {
+    LogWarn("Workers need the native backend, ninja compiles everything locally");
+  } else if (state.workerAddresses.length > 0) {
+    state.backend = BACKEND_NATIVE;
+    registerWorkers();
+  }
+
+  if (state.timeTrace && !usesClang()) {
+    LogWarn("-ftime-trace needs clang, building without the time trace report");
+    state.timeTrace = false;
+  }
+
+  if (state.backend == BACKEND_AUTO) {
+    state.backend = FindExecutable(S("ninja")) ? BACKEND_NINJA : BACKEND_NATIVE;
+    if (state.backend == BACKEND_NATIVE) {
+      LogWarn("ninja was not found on the PATH, using the native backend");
+    }
+  }
+
+  size_t current = executable.index;
+  if (!StrIsNull(&state.profileTraining)) {
+    trainProfile(current);
+  }
+
+  buildTargets();
+  executable = *VecAt(targets, current);
+  state.totalTime = TimeNow() - state.startTime;
+
+  // NOTE: Copied outside the arena, callers keep the path past EndBuild
+  Arena *arena = StrSetArena(NULL);
+  String path = StrNewSize(executable.path.data, executable.path.length);
+  StrSetArena(arena);
+  return path;
+}
+
+String InstallLibrary() {
+  return InstallExecutable();
+}
+
+errno_t RunCommand(String command) {
+  return system(command.data);
+}
+
+// TODO: Do it depending on compiler
+// NOTE: Appends `prefix` and every value to `flags` space separated, in one allocation instead of one per value
+static void appendFlags(String *flags, StringVector *vector, char *prefix, bool quoted) {
+  StrBuilder builder = StrBuilderNew(flags->length + vector->length * 64);
+  StrBuilderAppend(&builder, *flags);
+  for (size_t i = 0; i < vector->length; i++) {
+    StrBuilderAppendFormat(&builder, quoted ? "%s%s\"%s\"" : "%s%s%s", builder.length == 0 ? "" : " ", prefix, VecAt((*vector), i)->data);
+  }
+  *flags = StrBuilderToString(&builder);
+}
+
+static void addLibraryPaths(StringVector *vector) {
+  appendFlags(&executable.libs, vector, "-L", true);
+}
+
+// TODO: Same thing here
+static void addIncludePaths(StringVector *vector) {
+  appendFlags(&executable.includes, vector, "-I", true);
+}
+
+// NOTE: Targets have to be added before anything can link against them
+static void linkTargets(StringVector *vector) {
+  for (size_t i = 0; i < vector->length; i++) {
+    String name = *VecAt((*vector), i);
+    Executable *dependency = findTarget(name);
+    if (dependency == NULL || dependency->kind == TARGET_EXECUTABLE) {
+      LogError("%s isn't an added library, create it and call AddTarget() first", name.data);
+      abort();
+    }
+    VecPush(executable.dependencies, name);
+  }
+}
+
+static void linkSystemLibraries(StringVector *vector) {
+  appendFlags(&executable.libs, vector, "-l", false);
+}
+
+typedef struct {
+  String lane;
+  i64 end;
+} TraceThread;
+
+VEC_TYPE(TraceThreadVector, TraceThread);
+
+static i32 compareSpanStarts(const void *a, const void *b) {
+  i64 first = ((TraceSpan *)a)->start;
+  i64 second = ((TraceSpan *)b)->start;
+  return (first > second) - (first < second);
+}
+
+// NOTE: Chrome trace format, open it in chrome://tracing or ui.perfetto.dev. Spans of one lane that overlap
+// get their own thread so the viewer shows how many jobs were actually in flight
+static void writeTrace() {
+  String tracePath = FixPath(FormatMalloc("%s/trace.json", state.buildDirectory.data));
+  FILE *file = fopen(tracePath.data, "w");
+  if (file == NULL) {
+    LogError("Failed to open output file '%s'", tracePath.data);
+    return;
+  }
+
+  qsort(traceSpans.data, traceSpans.length, sizeof(TraceSpan), compareSpanStarts);
+  TraceThreadVector threads = {0};
+  fprintf(file, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+  for (size_t i = 0; i < traceSpans.length; i++) {
+    TraceSpan *span = VecAt(traceSpans, i);
+    size_t thread = 0;
+    while (thread < threads.length && (!StrEqual(VecAt(threads, thread)->lane, span->lane) || VecAt(threads, thread)->end > span->start)) {
+      thread++;
+    }
+
+    if (thread == threads.length) {
+      VecPush(threads, ((TraceThread){.lane = span->lane}));
+      fprintf(file, "  {\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": %zu, \"args\": {\"name\": ", thread + 1);
+      writeJsonString(file, FormatMalloc("%s #%zu", span->lane.data, thread + 1));
+      fprintf(file, "}},\n");
+    }
+    VecAt(threads, thread)->end = span->end;
+
+    char *name = strrchr(span->output.data, '/');
+    fprintf(file, "  {\"name\": ");
+    writeJsonString(file, s(name == NULL ? span->output.data : name + 1));
+    fprintf(file, ", \"cat\": \"%s\", \"ph\": \"X\", \"pid\": 1, \"tid\": %zu, \"ts\": %lld, \"dur\": %lld, \"args\": {\"output\": ",
+            span->kind, thread + 1, (long long)span->start * 1000, (long long)(span->end - span->start) * 1000);
+    writeJsonString(file, span->output);
+    if (span->cpuTime >= 0) {
+      fprintf(file, ", \"cpu_ms\": %.3f, \"peak_rss_kb\": %lld", span->cpuTime / 1000.0, (long long)span->peakMemory);
+    }
+    fprintf(file, "}}%s\n", i + 1 == traceSpans.length ? "" : ",");
+  }
+  fprintf(file, "]}\n");
+  fclose(file);
+  if (threads.length > 0) {
+    VecFree(threads);
+  }
+}
+
+void EndBuild() {
+  state.cache.lastBuild = TimeNow() / 1000;
+  writeCache();
+  writeTrace();
+  LogInfo("Graph took: %llums", state.graphTime);
+  LogInfo("Build took: %llums", state.totalTime);
+
+  // NOTE: Everything the build made points into the arena, so it all goes with it and the next StartBuild starts clean
+  StrSetArena(NULL);
+  ArenaFree(&buildArena);
+  free(targets.data);
+  free(compileJobs.data);
+  free(pchJobs.data);
+  free(linkJobs.data);
+  free(workers.data);
+  free(traceSpans.data);
+  executable = (Executable){0};
+  targets = (TargetVector){0};
+  compileJobs = (BuildJobVector){0};
+  pchJobs = (BuildJobVector){0};
+  linkJobs = (BuildJobVector){0};
+  workers = (WorkerVector){0};
+  traceSpans = (TraceSpanVector){0};
+  profileMode = PROFILE_NONE;
+  profileFlags = (String){0};
+  profileStamp = (String){0};
+  profileBuildDirectory = (String){0};
+  lastObjectDirectory = (String){0};
+  compilerIdentityCache = (String){0};
 }
 #endif
\ No newline at end of file
@@ -0,0 +1,98 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stdint.h>
+#include "base.h"
+#include "log.h"
+
+// NOTE: Bump allocator over a list of chunks, memory only goes back all at once or down to a mark
+typedef struct ArenaChunk {
+  struct ArenaChunk *previous;
+  size_t used;
+  size_t capacity;
+  char data[];
+} ArenaChunk;
+
+typedef struct {
+  ArenaChunk *current;
+  size_t chunkSize; // NOTE: Defaults to 1MB, bigger allocations get a chunk of their own
+} Arena;
+
+typedef struct {
+  ArenaChunk *chunk;
+  size_t used;
+} ArenaMark;
+
+#define ARENA_DEFAULT_CHUNK_SIZE (1024 * 1024)
+#define ARENA_ALIGNMENT sizeof(void *) // NOTE: The chunk header is pointer aligned too, so `data` starts aligned
+
+void *ArenaAlloc(Arena *arena, size_t size);
+ArenaMark ArenaGetMark(Arena *arena);
+void ArenaReset(Arena *arena, ArenaMark mark); // NOTE: Frees everything allocated after `mark` was taken
+bool ArenaOwns(Arena *arena, void *pointer);
+void ArenaFree(Arena *arena);
+
+void *ArenaAlloc(Arena *arena, size_t size) {
+  if (size > SIZE_MAX - ARENA_ALIGNMENT) {
+    LogError("Arena allocation of %zu bytes is too big", size);
+    abort();
+  }
+  size = (size + ARENA_ALIGNMENT - 1) & ~(ARENA_ALIGNMENT - 1);
+
+  // NOTE: Compared as the space left so `used + size` can't wrap around past the chunk end
+  ArenaChunk *chunk = arena->current;
+  if (chunk == NULL || size > chunk->capacity - chunk->used) {
+    size_t chunkSize = arena->chunkSize > 0 ? arena->chunkSize : ARENA_DEFAULT_CHUNK_SIZE;
+    size_t capacity = size > chunkSize ? size : chunkSize;
+    chunk = (ArenaChunk *)malloc(sizeof(ArenaChunk) + capacity);
+    if (chunk == NULL) {
+      LogError("Couldn't allocate an arena chunk of %zu bytes", capacity);
+      abort();
+    }
+    chunk->previous = arena->current;
+    chunk->used = 0;
+    chunk->capacity = capacity;
+    arena->current = chunk;
+  }
+
+  void *result = chunk->data + chunk->used;
+  chunk->used += size;
+  return result;
+}
+
+ArenaMark ArenaGetMark(Arena *arena) {
+  return (ArenaMark){
+      .chunk = arena->current,
+      .used = arena->current == NULL ? 0 : arena->current->used,
+  };
+}
+
+void ArenaReset(Arena *arena, ArenaMark mark) {
+  while (arena->current != NULL && arena->current != mark.chunk) {
+    ArenaChunk *previous = arena->current->previous;
+    free(arena->current);
+    arena->current = previous;
+  }
+
+  if (arena->current != NULL) {
+    assert(mark.used <= arena->current->used && "mark should be taken before the allocations it resets");
+    arena->current->used = mark.used;
+  }
+}
+
+bool ArenaOwns(Arena *arena, void *pointer) {
+  uintptr_t address = (uintptr_t)pointer;
+  for (ArenaChunk *chunk = arena->current; chunk != NULL; chunk = chunk->previous) {
+    uintptr_t start = (uintptr_t)chunk->data;
+    if (address >= start && address < start + chunk->capacity) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void ArenaFree(Arena *arena) {
+  ArenaReset(arena, (ArenaMark){0});
+}
+
+#endif
@@ -91,6 +91,8 @@
 #define execve _execve
 #define sleep(x) Sleep((x) * 1000)
 #define usleep(x) Sleep((x) / 1000)
+#define setenv(name, value, overwrite) _putenv_s(name, value)
+#define unsetenv(name) _putenv_s(name, "")
 
 /* String functions */
 #define strcasecmp _stricmp
@@ -160,6 +162,7 @@ enum GeneralError {
 
 /* --- Time and Platforms --- */
 i64 TimeNow();
+i64 TimeNanoseconds(); // NOTE: Monotonic, only meaningful as a difference
 void WaitTime(i64 ms);
 
 
@@ -205,8 +208,12 @@ static inline void __df_cb(__df_t *__fp) {
 
 #ifdef BASE_IMPLEMENTATION
 
+#include "arena.h"
 #include "fs.h"
+#include "intern.h"
 #include "log.h"
+#include "net.h"
+#include "process.h"
 #include "random.h"
 #include "str.h"
 #include "vectors.h"
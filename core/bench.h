@@ -0,0 +1,117 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include "base.h"
+#include "vectors.h"
+
+// NOTE: `function` runs the measured operation `iterations` times, so operations shorter than the clock's resolution add up
+typedef void (*BenchFunction)(void *context, i64 iterations);
+
+typedef struct {
+  i32 warmup;       // NOTE: Samples thrown away before measuring, defaults to 3
+  i32 repetitions;  // NOTE: Measured samples, defaults to 31
+  i64 minimumSample; // NOTE: Nanoseconds a sample should at least take, picks `iterations`, defaults to 1ms
+} BenchOptions;
+
+typedef struct {
+  char *name;
+  i64 iterations; // NOTE: Operations per sample
+  i32 samples;
+  f64 median;     // NOTE: Nanoseconds per operation
+  f64 p99;
+  f64 minimum;
+  f64 mean;
+} BenchResult;
+
+VEC_TYPE(BenchResultVector, BenchResult);
+
+BenchResult BenchRun(char *name, BenchFunction function, void *context, BenchOptions options);
+void BenchPrint(BenchResultVector *results); // NOTE: Human readable table on stdout
+errno_t BenchWriteJson(BenchResultVector *results, char *path);
+
+// NOTE: Makes the compiler assume `pointer` is read, so the work producing it isn't optimized away
+#if defined(COMPILER_GCC) || defined(COMPILER_CLANG)
+#define BenchKeep(pointer) __asm__ volatile("" : : "g"(pointer) : "memory")
+#else
+static void *volatile benchSink;
+#define BenchKeep(pointer) (benchSink = (void *)(pointer))
+#endif
+
+static i32 compareBenchSamples(const void *a, const void *b) {
+  f64 first = *(f64 *)a;
+  f64 second = *(f64 *)b;
+  return (first > second) - (first < second);
+}
+
+static i64 benchSample(BenchFunction function, void *context, i64 iterations) {
+  i64 start = TimeNanoseconds();
+  function(context, iterations);
+  return TimeNanoseconds() - start;
+}
+
+BenchResult BenchRun(char *name, BenchFunction function, void *context, BenchOptions options) {
+  i32 warmup = options.warmup > 0 ? options.warmup : 3;
+  i32 repetitions = options.repetitions > 0 ? options.repetitions : 31;
+  i64 minimumSample = options.minimumSample > 0 ? options.minimumSample : 1000000;
+
+  // NOTE: Doubles the batch until one sample is long enough to measure, this also warms the caches up
+  i64 iterations = 1;
+  while (benchSample(function, context, iterations) < minimumSample && iterations < (1LL << 40)) {
+    iterations *= 2;
+  }
+
+  for (i32 i = 0; i < warmup; i++) {
+    benchSample(function, context, iterations);
+  }
+
+  f64 *samples = malloc(sizeof(f64) * repetitions);
+  f64 total = 0;
+  for (i32 i = 0; i < repetitions; i++) {
+    samples[i] = (f64)benchSample(function, context, iterations) / iterations;
+    total += samples[i];
+  }
+  qsort(samples, repetitions, sizeof(f64), compareBenchSamples);
+
+  i32 p99 = (i32)(repetitions * 0.99 + 0.5) - 1;
+  BenchResult result = {
+      .name = name,
+      .iterations = iterations,
+      .samples = repetitions,
+      .median = samples[repetitions / 2],
+      .p99 = samples[p99 < 0 ? 0 : p99],
+      .minimum = samples[0],
+      .mean = total / repetitions,
+  };
+  free(samples);
+  return result;
+}
+
+void BenchPrint(BenchResultVector *results) {
+  printf("%-32s %14s %14s %14s %12s\n", "benchmark", "median ns/op", "p99 ns/op", "min ns/op", "ops/sample");
+  for (size_t i = 0; i < results->length; i++) {
+    BenchResult *result = VecAt((*results), i);
+    printf("%-32s %14.1f %14.1f %14.1f %12lld\n", result->name, result->median, result->p99, result->minimum, (long long)result->iterations);
+  }
+}
+
+errno_t BenchWriteJson(BenchResultVector *results, char *path) {
+  FILE *file = fopen(path, "w");
+  if (file == NULL) {
+    LogError("Failed to open output file '%s'", path);
+    return FILE_WRITE_FAILED;
+  }
+
+  fprintf(file, "{\n  \"benchmarks\": [\n");
+  for (size_t i = 0; i < results->length; i++) {
+    BenchResult *result = VecAt((*results), i);
+    fprintf(file,
+            "    {\"name\": \"%s\", \"iterations\": %lld, \"samples\": %d, \"medianNs\": %.3f, \"p99Ns\": %.3f, \"minNs\": %.3f, \"meanNs\": %.3f}%s\n",
+            result->name, (long long)result->iterations, result->samples, result->median, result->p99, result->minimum, result->mean,
+            i + 1 == results->length ? "" : ",");
+  }
+  fprintf(file, "  ]\n}\n");
+  fclose(file);
+  return SUCCESS;
+}
+
+#endif
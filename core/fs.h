@@ -1,6 +1,7 @@
 #ifndef FILESYSTEM_H
 #define FILESYSTEM_H
 
+#include "intern.h"
 #include "str.h"
 
 typedef struct {
@@ -15,9 +16,11 @@ typedef struct folder_t {
 
   struct folder_t *folders;
   size_t folderCount;
+  size_t folderCapacity;
 
   File *files;
   size_t fileCount;
+  size_t fileCapacity;
 
   size_t totalCount;
 } Folder;
@@ -33,13 +36,16 @@ enum FileError {
   FILE_RENAME_FAILED
 };
 
-String GetCwd();
+String GetCwd(); // NOTE: Interned and cached until SetCwd, so callers can compare and keep it for free
 void SetCwd(String destination);
 Folder *GetDirFiles(String initial);
 Folder *NewFolder();
 void FreeFolder(Folder *folder);
 errno_t FileStats(String *path, File *file);
+errno_t FileModifyTime(String *path, i64 *modifyTime); // NOTE: Nanoseconds, quietly returns FILE_NOT_EXIST
+errno_t FileTouch(String *path);
 errno_t FileRead(String *path, String *result);
+void FileFreeContent(String content); // NOTE: FileRead's buffers are always malloc'd, this frees them even while an arena is set
 errno_t FileWrite(String *path, String *data);
 errno_t FileDelete(String *path);
 errno_t FileRename(String *oldPath, String *newPath);
@@ -47,25 +53,52 @@ bool Mkdir(String path);
 
 #define MAX_FILES 200
 
+static String cachedCwd = {0};
+
 /* File Implementation */
+void FileFreeContent(String content) {
+  free(content.data);
+}
+
 Folder *NewFolder() {
   Folder *fileData = (Folder *)malloc(sizeof(Folder));
   fileData->files = (File *)malloc(MAX_FILES * sizeof(File));
   fileData->fileCount = 0;
+  fileData->fileCapacity = MAX_FILES;
   fileData->folders = (Folder *)malloc(MAX_FILES * sizeof(Folder));
   fileData->folderCount = 0;
+  fileData->folderCapacity = MAX_FILES;
   fileData->totalCount = 0;
   fileData->name = S("");
   return fileData;
 };
 
+// NOTE: Grows the entry arrays before adding, `MAX_FILES` is only the initial capacity
+void FolderReserve(Folder *folder) {
+  if (folder->fileCount == folder->fileCapacity) {
+    folder->fileCapacity *= 2;
+    folder->files = (File *)realloc(folder->files, folder->fileCapacity * sizeof(File));
+  }
+
+  if (folder->folderCount == folder->folderCapacity) {
+    folder->folderCapacity *= 2;
+    folder->folders = (Folder *)realloc(folder->folders, folder->folderCapacity * sizeof(Folder));
+  }
+}
+
+// NOTE: Names come from StrNew, so inside an arena these frees do nothing and the arena takes them back
 void _freeFolderRecursiveImpl(Folder *folder){ 
+  for (size_t i = 0; i < folder->fileCount; i++) {
+    StrFree(folder->files[i].name);
+    StrFree(s(folder->files[i].extension));
+  }
   free(folder->files);
   folder->totalCount -= folder->fileCount;
 
   for (size_t i = 0; i < folder->folderCount; i++) {
     Folder *subfolder = folder->folders + i;
     _freeFolderRecursiveImpl(subfolder);
+    StrFree(subfolder->name);
     folder->totalCount--;
   }
   free(folder->folders);
@@ -0,0 +1,141 @@
+#ifndef HASHMAP_H
+#define HASHMAP_H
+
+#include "base.h"
+#include "hashset.h"
+#include "log.h"
+#include "str.h"
+
+// NOTE: Generates a map from `keyType` to `valueType` in the style of VEC_TYPE, with typed and inlineable
+// `<typeName>Find/Insert/Erase/Free`. It's the same Swiss table as HashSet, `hashFunction(key)` returns a u64 and
+// `equalFunction(a, b)` a bool. A zeroed map is empty, pointers from Find and Insert stay valid until the next Insert.
+//
+//   HASHMAP_TYPE(TargetMap, String, size_t, HashStringKey, StrEqual)
+//   TargetMap targets = {0};
+//   TargetMapInsert(&targets, S("core"), 0);
+//   size_t *index = TargetMapFind(&targets, S("core"));
+#define HASHMAP_TYPE(typeName, keyType, valueType, hashFunction, equalFunction)                                                                                                                                                                \
+  typedef struct {                                                                                                                                                                                                                             \
+    keyType key;                                                                                                                                                                                                                               \
+    valueType value;                                                                                                                                                                                                                           \
+  } typeName##Entry;                                                                                                                                                                                                                           \
+                                                                                                                                                                                                                                               \
+  typedef struct {                                                                                                                                                                                                                             \
+    typeName##Entry *entries;                                                                                                                                                                                                                  \
+    u8 *control;                                                                                                                                                                                                                               \
+    u64 capacity;                                                                                                                                                                                                                              \
+    u64 size;                                                                                                                                                                                                                                  \
+    u64 tombstones;                                                                                                                                                                                                                            \
+  } typeName;                                                                                                                                                                                                                                  \
+                                                                                                                                                                                                                                               \
+  static inline u64 typeName##Slot(typeName *map, keyType key, u64 hash) {                                                                                                                                                                     \
+    if (map->capacity == 0) {                                                                                                                                                                                                                  \
+      return 0;                                                                                                                                                                                                                                \
+    }                                                                                                                                                                                                                                          \
+    u64 group = hashSetFirstGroup(map->capacity, hash);                                                                                                                                                                                        \
+    for (u64 step = 1;; step++) {                                                                                                                                                                                                              \
+      u8 *control = map->control + group;                                                                                                                                                                                                      \
+      for (u32 matches = hashSetMatch(control, hashSetTag(hash)); matches != 0; matches &= matches - 1) {                                                                                                                                      \
+        u64 index = group + hashSetLowestBit(matches);                                                                                                                                                                                         \
+        if (equalFunction(map->entries[index].key, key)) {                                                                                                                                                                                     \
+          return index;                                                                                                                                                                                                                        \
+        }                                                                                                                                                                                                                                      \
+      }                                                                                                                                                                                                                                        \
+      if (hashSetMatch(control, HASHSET_EMPTY) != 0) {                                                                                                                                                                                         \
+        return map->capacity;                                                                                                                                                                                                                  \
+      }                                                                                                                                                                                                                                        \
+      group = hashSetNextGroup(map->capacity, group, step);                                                                                                                                                                                    \
+    }                                                                                                                                                                                                                                          \
+  }                                                                                                                                                                                                                                            \
+                                                                                                                                                                                                                                               \
+  static inline valueType *typeName##Find(typeName *map, keyType key) {                                                                                                                                                                        \
+    u64 index = typeName##Slot(map, key, hashFunction(key));                                                                                                                                                                                   \
+    return index == map->capacity ? NULL : &map->entries[index].value;                                                                                                                                                                         \
+  }                                                                                                                                                                                                                                            \
+                                                                                                                                                                                                                                               \
+  static inline void typeName##Rehash(typeName *map, u64 capacity) {                                                                                                                                                                           \
+    typeName##Entry *entries = map->entries;                                                                                                                                                                                                   \
+    u8 *control = map->control;                                                                                                                                                                                                                \
+    u64 oldCapacity = map->capacity;                                                                                                                                                                                                           \
+                                                                                                                                                                                                                                               \
+    map->entries = (typeName##Entry *)malloc(capacity * sizeof(typeName##Entry));                                                                                                                                                              \
+    map->control = (u8 *)malloc(capacity);                                                                                                                                                                                                     \
+    if (map->entries == NULL || map->control == NULL) {                                                                                                                                                                                        \
+      LogError("Couldn't grow " #typeName " to %llu entries", (unsigned long long)capacity);                                                                                                                                                   \
+      abort();                                                                                                                                                                                                                                 \
+    }                                                                                                                                                                                                                                          \
+    memset(map->control, HASHSET_EMPTY, capacity);                                                                                                                                                                                             \
+    map->capacity = capacity;                                                                                                                                                                                                                  \
+    map->tombstones = 0;                                                                                                                                                                                                                       \
+                                                                                                                                                                                                                                               \
+    for (u64 i = 0; i < oldCapacity; i++) {                                                                                                                                                                                                    \
+      if (control[i] & HASHSET_EMPTY) {                                                                                                                                                                                                        \
+        continue;                                                                                                                                                                                                                              \
+      }                                                                                                                                                                                                                                        \
+      u64 hash = hashFunction(entries[i].key);                                                                                                                                                                                                 \
+      u64 index = hashSetFindFree(map->control, capacity, hash);                                                                                                                                                                               \
+      map->control[index] = hashSetTag(hash);                                                                                                                                                                                                  \
+      map->entries[index] = entries[i];                                                                                                                                                                                                        \
+    }                                                                                                                                                                                                                                          \
+    free(entries);                                                                                                                                                                                                                             \
+    free(control);                                                                                                                                                                                                                             \
+  }                                                                                                                                                                                                                                            \
+                                                                                                                                                                                                                                               \
+  static inline valueType *typeName##Insert(typeName *map, keyType key, valueType value) {                                                                                                                                                     \
+    u64 hash = hashFunction(key);                                                                                                                                                                                                              \
+    u64 index = typeName##Slot(map, key, hash);                                                                                                                                                                                                \
+    if (index != map->capacity) {                                                                                                                                                                                                              \
+      map->entries[index].value = value;                                                                                                                                                                                                       \
+      return &map->entries[index].value;                                                                                                                                                                                                       \
+    }                                                                                                                                                                                                                                          \
+                                                                                                                                                                                                                                               \
+    if ((map->size + map->tombstones + 1) * 8 > map->capacity * 7) {                                                                                                                                                                           \
+      bool grow = (map->size + 1) * 16 > map->capacity * 7;                                                                                                                                                                                    \
+      typeName##Rehash(map, map->capacity == 0 ? HASHSET_GROUP : grow ? map->capacity * 2 : map->capacity);                                                                                                                                    \
+    }                                                                                                                                                                                                                                          \
+                                                                                                                                                                                                                                               \
+    index = hashSetFindFree(map->control, map->capacity, hash);                                                                                                                                                                                \
+    if (map->control[index] == HASHSET_DELETED) {                                                                                                                                                                                              \
+      map->tombstones--;                                                                                                                                                                                                                       \
+    }                                                                                                                                                                                                                                          \
+    map->control[index] = hashSetTag(hash);                                                                                                                                                                                                    \
+    map->entries[index] = (typeName##Entry){.key = key, .value = value};                                                                                                                                                                       \
+    map->size++;                                                                                                                                                                                                                               \
+    return &map->entries[index].value;                                                                                                                                                                                                         \
+  }                                                                                                                                                                                                                                            \
+                                                                                                                                                                                                                                               \
+  static inline bool typeName##Erase(typeName *map, keyType key) {                                                                                                                                                                             \
+    u64 index = typeName##Slot(map, key, hashFunction(key));                                                                                                                                                                                   \
+    if (index == map->capacity) {                                                                                                                                                                                                              \
+      return false;                                                                                                                                                                                                                            \
+    }                                                                                                                                                                                                                                          \
+    u64 group = index & ~(u64)(HASHSET_GROUP - 1);                                                                                                                                                                                             \
+    if (hashSetMatch(map->control + group, HASHSET_EMPTY) != 0) {                                                                                                                                                                              \
+      map->control[index] = HASHSET_EMPTY;                                                                                                                                                                                                     \
+    } else {                                                                                                                                                                                                                                   \
+      map->control[index] = HASHSET_DELETED;                                                                                                                                                                                                   \
+      map->tombstones++;                                                                                                                                                                                                                       \
+    }                                                                                                                                                                                                                                          \
+    map->size--;                                                                                                                                                                                                                               \
+    return true;                                                                                                                                                                                                                               \
+  }                                                                                                                                                                                                                                            \
+                                                                                                                                                                                                                                               \
+  static inline void typeName##Free(typeName *map) {                                                                                                                                                                                           \
+    free(map->entries);                                                                                                                                                                                                                        \
+    free(map->control);                                                                                                                                                                                                                        \
+    *map = (typeName){0};                                                                                                                                                                                                                      \
+  }
+
+static inline u64 HashStringKey(String key) {
+  return wyhash(key.data, key.length, 0);
+}
+
+static inline u64 HashU64Key(u64 key) {
+  return wyMix(key ^ wySecret[0], wySecret[1]);
+}
+
+static inline bool EqualU64Key(u64 a, u64 b) {
+  return a == b;
+}
+
+#endif
@@ -5,33 +5,230 @@
 #include "base.h"
 #include "str.h"
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define HASHSET_SSE2
+#include <emmintrin.h>
+#endif
+
+#ifdef COMPILER_MSVC
+#include <intrin.h>
+#endif
+
 typedef struct {
   String key;
 } HashEntry;
 
+// NOTE: Swiss table, every slot has a control byte that is EMPTY, DELETED or the low 7 bits of the key's hash.
+// Lookups compare the control bytes of 16 slots at once and only look at keys whose 7 bits match.
 typedef struct {
-  u64 capacity;
+  u64 capacity; // NOTE: Power of two, at least one group
   u64 size;
-  void* entries;
-  bool* is_taken;
+  u64 tombstones;
+  HashEntry* entries;
+  u8* control;
 } HashSet;
 
+#define HASHSET_GROUP 16
+#define HASHSET_EMPTY 0x80
+#define HASHSET_DELETED 0xFE
+
 static u64 hash(String);
 
 HashSet *HashSetNew(u64 capacity);
 bool HashSetContains(HashSet *, String);
 void HashSetInsert(HashSet *, String);
-HashEntry *HashSetDelete(HashSet *, String);
+HashEntry *HashSetDelete(HashSet *, String); // NOTE: The entry stays readable until the next insert
 void HashSetFree(HashSet *);
 
 
+/* wyhash (final version 4, public domain) */
+static const u64 wySecret[4] = {0x2d358dccaa6c78a5ULL, 0x8bb84b93962eacc9ULL, 0x4b33a62ed433d4a3ULL, 0x4d5a2da51de1aa47ULL};
+
+static void wyMultiply(u64 *a, u64 *b) {
+#if defined(__SIZEOF_INT128__)
+    __uint128_t result = (__uint128_t)*a * *b;
+    *a = (u64)result;
+    *b = (u64)(result >> 64);
+#elif defined(COMPILER_MSVC) && defined(_M_X64)
+    *a = _umul128(*a, *b, b);
+#else
+    u64 ha = *a >> 32, hb = *b >> 32, la = (u32)*a, lb = (u32)*b;
+    u64 rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+    u64 t = rl + (rm0 << 32), carry = t < rl;
+    u64 low = t + (rm1 << 32);
+    carry += low < t;
+    *a = low;
+    *b = rh + (rm0 >> 32) + (rm1 >> 32) + carry;
+#endif
+}
+
+static u64 wyMix(u64 a, u64 b) {
+    wyMultiply(&a, &b);
+    return a ^ b;
+}
+
+// NOTE: Little endian reads, which every platform bilt supports is
+static u64 wyRead8(const u8 *p) {
+    u64 value;
+    memcpy(&value, p, 8);
+    return value;
+}
+
+static u64 wyRead4(const u8 *p) {
+    u32 value;
+    memcpy(&value, p, 4);
+    return value;
+}
+
+static u64 wyRead3(const u8 *p, size_t length) {
+    return ((u64)p[0] << 16) | ((u64)p[length >> 1] << 8) | p[length - 1];
+}
+
+static u64 wyhash(const void *key, size_t length, u64 seed) {
+    const u8 *p = (const u8 *)key;
+    seed ^= wyMix(seed ^ wySecret[0], wySecret[1]);
+    u64 a, b;
+    if (length <= 16) {
+        if (length >= 4) {
+            a = (wyRead4(p) << 32) | wyRead4(p + ((length >> 3) << 2));
+            b = (wyRead4(p + length - 4) << 32) | wyRead4(p + length - 4 - ((length >> 3) << 2));
+        } else if (length > 0) {
+            a = wyRead3(p, length);
+            b = 0;
+        } else {
+            a = b = 0;
+        }
+    } else {
+        size_t i = length;
+        if (i > 48) {
+            u64 seed1 = seed, seed2 = seed;
+            do {
+                seed = wyMix(wyRead8(p) ^ wySecret[1], wyRead8(p + 8) ^ seed);
+                seed1 = wyMix(wyRead8(p + 16) ^ wySecret[2], wyRead8(p + 24) ^ seed1);
+                seed2 = wyMix(wyRead8(p + 32) ^ wySecret[3], wyRead8(p + 40) ^ seed2);
+                p += 48;
+                i -= 48;
+            } while (i > 48);
+            seed ^= seed1 ^ seed2;
+        }
+        while (i > 16) {
+            seed = wyMix(wyRead8(p) ^ wySecret[1], wyRead8(p + 8) ^ seed);
+            i -= 16;
+            p += 16;
+        }
+        a = wyRead8(p + i - 16);
+        b = wyRead8(p + i - 8);
+    }
+    a ^= wySecret[1];
+    b ^= seed;
+    wyMultiply(&a, &b);
+    return wyMix(a ^ wySecret[0] ^ length, b ^ wySecret[1]);
+}
+
 static u64 hash(String key) {
-    u64 sum_product = 0;
-    for (size_t i = 0; i < key.length; i++) {
-        sum_product += key.data[i];
-        sum_product *= key.data[i];
+    return wyhash(key.data, key.length, 0);
+}
+
+/* Control byte groups */
+static u32 hashSetMatch(const u8 *group, u8 value) {
+#ifdef HASHSET_SSE2
+    __m128i bytes = _mm_loadu_si128((const __m128i *)group);
+    return (u32)_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, _mm_set1_epi8((char)value)));
+#else
+    u32 mask = 0;
+    for (u32 i = 0; i < HASHSET_GROUP; i++) {
+        mask |= (u32)(group[i] == value) << i;
+    }
+    return mask;
+#endif
+}
+
+static u32 hashSetLowestBit(u32 mask) {
+#ifdef COMPILER_MSVC
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return (u32)index;
+#else
+    return (u32)__builtin_ctz(mask);
+#endif
+}
+
+static u8 hashSetTag(u64 hash_of_key) {
+    return (u8)(hash_of_key & 0x7F);
+}
+
+// NOTE: Groups are probed triangularly, 1, 2, 3... groups apart, which visits every group of a power of two table once.
+// The HASHMAP_TYPE maps in hashmap.h probe their control bytes the same way
+static u64 hashSetFirstGroup(u64 capacity, u64 hash_of_key) {
+    return (hash_of_key >> 7) & (capacity - 1) & ~(u64)(HASHSET_GROUP - 1);
+}
+
+static u64 hashSetNextGroup(u64 capacity, u64 group, u64 step) {
+    return (group + step * HASHSET_GROUP) & (capacity - 1);
+}
+
+static u64 hashSetFindFree(u8 *control, u64 capacity, u64 hash_of_key) {
+    u64 group = hashSetFirstGroup(capacity, hash_of_key);
+    for (u64 step = 1;; step++) {
+        u32 free_slots = hashSetMatch(control + group, HASHSET_EMPTY) | hashSetMatch(control + group, HASHSET_DELETED);
+        if (free_slots != 0) {
+            return group + hashSetLowestBit(free_slots);
+        }
+        group = hashSetNextGroup(capacity, group, step);
+    }
+}
+
+static u64 hashSetFind(HashSet *hashset, String key, u64 hash_of_key) {
+    u64 group = hashSetFirstGroup(hashset->capacity, hash_of_key);
+    u8 tag = hashSetTag(hash_of_key);
+    for (u64 step = 1;; step++) {
+        u8 *control = hashset->control + group;
+        for (u32 matches = hashSetMatch(control, tag); matches != 0; matches &= matches - 1) {
+            u64 index = group + hashSetLowestBit(matches);
+            if (StrEqual(hashset->entries[index].key, key)) {
+                return index;
+            }
+        }
+
+        // NOTE: An empty slot means the key was never pushed past this group
+        if (hashSetMatch(control, HASHSET_EMPTY) != 0) {
+            return hashset->capacity;
+        }
+        group = hashSetNextGroup(hashset->capacity, group, step);
     }
-    return sum_product;
+}
+
+static void hashSetAllocate(HashSet *hashset, u64 capacity) {
+    hashset->capacity = capacity;
+    hashset->entries = calloc(capacity, sizeof(HashEntry));
+    hashset->control = malloc(capacity);
+    if (hashset->entries == NULL || hashset->control == NULL) {
+        perror("Couldn't allocate the hashset's slots\n");
+        exit(1);
+    }
+    memset(hashset->control, HASHSET_EMPTY, capacity);
+}
+
+// NOTE: Also how the tombstones go away, a rehash to the same capacity drops them
+static void hashSetRehash(HashSet *hashset, u64 capacity) {
+    HashEntry *old_entries = hashset->entries;
+    u8 *old_control = hashset->control;
+    u64 old_capacity = hashset->capacity;
+
+    hashSetAllocate(hashset, capacity);
+    for (u64 i = 0; i < old_capacity; i++) {
+        if (old_control[i] & HASHSET_EMPTY) {
+            continue; // NOTE: Both EMPTY and DELETED have the high bit set
+        }
+        u64 hash_of_key = hash(old_entries[i].key);
+        u64 index = hashSetFindFree(hashset->control, hashset->capacity, hash_of_key);
+        hashset->control[index] = hashSetTag(hash_of_key);
+        hashset->entries[index] = old_entries[i];
+    }
+    hashset->tombstones = 0;
+
+    free(old_entries);
+    free(old_control);
 }
 
 HashSet *HashSetNew(u64 capacity) {
@@ -39,35 +236,26 @@ HashSet *HashSetNew(u64 capacity) {
     if (hashset == NULL) {
         return NULL;
     }
-    hashset->capacity = capacity;
+
+    u64 rounded = HASHSET_GROUP;
+    while (rounded < capacity) {
+        rounded *= 2;
+    }
     hashset->size = 0;
-    hashset->entries = calloc(hashset->capacity, sizeof(HashEntry));
-    hashset->is_taken = calloc(hashset->capacity, sizeof(int));
+    hashset->tombstones = 0;
+    hashSetAllocate(hashset, rounded);
     return hashset;
 }
 
 bool
 HashSetContains(
-    HashSet *hashset, 
+    HashSet *hashset,
     String key
 ) {
     if (hashset == NULL || StrIsNull(&key)) {
-        return NULL;
+        return false;
     }
-
-    u64 hash_of_key = hash(key);
-    u64 index = hash_of_key % hashset->capacity;
-
-    HashEntry *he = hashset->entries + index;
-
-    do {
-        if (StrEqual(he->key, key)) {
-            return true;
-        }
-        index++;
-        he = hashset->entries + index;
-    } while(index < hashset->size);
-    return false;
+    return hashSetFind(hashset, key, hash(key)) != hashset->capacity;
 }
 
 void
@@ -75,68 +263,28 @@ HashSetInsert(
     HashSet *hashset,
     String key
 ) {
-    if (hashset == NULL // The hashset is null
-        || StrIsNull(&key) // The key is null
-        || HashSetContains(hashset, key) // The already in the table
-        ) {
-            return;
-        }
-
-    f64 load_factor = (f64)(hashset->size + 1) / (f64)hashset->capacity;
-
-    if (load_factor > 0.6) {
-        HashEntry *new_entries = calloc(hashset->capacity * 2, sizeof(HashEntry));
-        if (new_entries == NULL) {
-            perror("calloc failed while allocating space for another entries array\n");
-            exit(1);
-        }
-        bool *new_taken = calloc(hashset->capacity * 2, sizeof(bool));
-        if (new_taken == NULL) {
-            perror("calloc failed while allocating space for another is_taken array\n");
-            exit(1);
-        }
-        for (int i = 0; i < hashset->capacity; i++) {
-            if (hashset->is_taken[i] == 0) {
-                continue;
-            }
-            HashEntry *original = hashset->entries + i;
-            u64 hash_of_entry = hash(original->key);
-            u64 index_of_entry = hash_of_entry % (hashset->capacity * 2);
-            while (
-                index_of_entry < hashset->capacity * 2
-                && new_taken[index_of_entry] == 1) {
-                index_of_entry++;
-            }
+    if (hashset == NULL || StrIsNull(&key)) {
+        return;
+    }
 
-            HashEntry *he = new_entries + index_of_entry;
-            if (he != NULL) {
-            }
-            he->key = original->key;
-            new_taken[index_of_entry] = 1;
-            
-        }
-        hashset->capacity *= 2;
-        free(hashset->entries);
-        hashset->entries = new_entries;
-        free(hashset->is_taken);
-        hashset->is_taken = new_taken;
+    u64 hash_of_key = hash(key);
+    if (hashSetFind(hashset, key, hash_of_key) != hashset->capacity) {
+        return;
     }
-    u64 hash_of_target = hash(key);
-    u64 index = hash_of_target % hashset->capacity;
 
-    while (
-        index < hashset->capacity
-        && hashset->is_taken[index]) {
-        index++;
+    // NOTE: Tombstones count towards the 7/8 load, probes have to step over them as well
+    if ((hashset->size + hashset->tombstones + 1) * 8 > hashset->capacity * 7) {
+        bool grow = (hashset->size + 1) * 16 > hashset->capacity * 7;
+        hashSetRehash(hashset, grow ? hashset->capacity * 2 : hashset->capacity);
     }
 
-    if (index < hashset->capacity) {
-        HashEntry *he = hashset->entries + index;
-        
-        he->key = key;
-        hashset->is_taken[index] = true;
-        hashset->size++;
+    u64 index = hashSetFindFree(hashset->control, hashset->capacity, hash_of_key);
+    if (hashset->control[index] == HASHSET_DELETED) {
+        hashset->tombstones--;
     }
+    hashset->control[index] = hashSetTag(hash_of_key);
+    hashset->entries[index].key = key;
+    hashset->size++;
 }
 
 HashEntry *
@@ -144,46 +292,38 @@ HashSetDelete(
     HashSet *hashset,
     String key
 ) {
-    if (
-        hashset == NULL
-        || StrIsNull(&key)
-        || !HashSetContains(hashset, key)) {
-            return NULL;
-        }
-    
-    u64 hash_of_key = hash(key);
-    u64 index = hash_of_key % hashset->capacity;
-
-    HashEntry *he = hashset->entries + index;
-
-    while (
-        index < hashset->capacity 
-        && hashset->is_taken[index] == 1
-        && StrEqual(he->key, key) != 0) {
-            index++;
-            he = hashset->entries + index;
-        } 
-    
-    if (hashset->is_taken[index] == 1) {
-        hashset->is_taken[index] = 0;
-        return he;
+    if (hashset == NULL || StrIsNull(&key)) {
+        return NULL;
     }
 
-    return NULL;
+    u64 index = hashSetFind(hashset, key, hash(key));
+    if (index == hashset->capacity) {
+        return NULL;
+    }
 
+    // NOTE: Probes stop at a group with an empty slot, so the slot can go back to empty without breaking any chain
+    u64 group = index & ~(u64)(HASHSET_GROUP - 1);
+    if (hashSetMatch(hashset->control + group, HASHSET_EMPTY) != 0) {
+        hashset->control[index] = HASHSET_EMPTY;
+    } else {
+        hashset->control[index] = HASHSET_DELETED;
+        hashset->tombstones++;
+    }
+    hashset->size--;
+    return hashset->entries + index;
 }
 
 void
 HashSetFree(
     HashSet *hashset
 ) {
-    for (u32 i = 0; i < hashset->capacity; i++) {
-        if (hashset->is_taken[i] == 0) continue;
-        StrFree(((HashEntry *)(hashset->entries + i))->key);
+    for (u64 i = 0; i < hashset->capacity; i++) {
+        if (hashset->control[i] & HASHSET_EMPTY) continue;
+        StrFree(hashset->entries[i].key);
     }
     free(hashset->entries);
-    free(hashset->is_taken);
+    free(hashset->control);
     free(hashset);
 }
 
-#endif
\ No newline at end of file
+#endif
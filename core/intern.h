@@ -0,0 +1,129 @@
+#ifndef INTERN_H
+#define INTERN_H
+
+#include "arena.h"
+#include "base.h"
+#include "str.h"
+
+// NOTE: Keeps one copy of every distinct string, equal contents get the same pointer so comparing them is a pointer
+// compare. The copies live until the process exits and are read only, StrFree leaves them alone.
+typedef struct {
+  u64 capacity; // NOTE: Power of two
+  u64 size;
+  String *entries;
+  u64 *hashes;
+  Arena arena;
+} InternTable;
+
+String InternTableAdd(InternTable *table, String string);
+bool InternTableOwns(InternTable *table, String string);
+void InternTableFree(InternTable *table);
+
+String StrIntern(String string); // NOTE: Goes through the process wide table
+
+static InternTable internTable = {0};
+
+static u64 internHash(String string) {
+  u64 result = 14695981039346656037ULL; // NOTE: FNV-1a
+  for (size_t i = 0; i < string.length; i++) {
+    result ^= (u8)string.data[i];
+    result *= 1099511628211ULL;
+  }
+  return result;
+}
+
+static void internTableGrow(InternTable *table) {
+  u64 capacity = table->capacity == 0 ? 1024 : table->capacity * 2;
+  String *entries = calloc(capacity, sizeof(String));
+  u64 *hashes = calloc(capacity, sizeof(u64));
+  if (entries == NULL || hashes == NULL) {
+    LogError("Couldn't grow the intern table to %llu entries", (unsigned long long)capacity);
+    abort();
+  }
+
+  for (u64 i = 0; i < table->capacity; i++) {
+    if (table->entries[i].data == NULL) {
+      continue;
+    }
+    u64 index = table->hashes[i] & (capacity - 1);
+    while (entries[index].data != NULL) {
+      index = (index + 1) & (capacity - 1);
+    }
+    entries[index] = table->entries[i];
+    hashes[index] = table->hashes[i];
+  }
+
+  free(table->entries);
+  free(table->hashes);
+  table->entries = entries;
+  table->hashes = hashes;
+  table->capacity = capacity;
+}
+
+// NOTE: Linear probing, the stored hash skips the memcmp for almost every other string on the way. Returns the slot
+// holding `string` or the empty slot it would go in
+static u64 internTableFind(InternTable *table, String string, u64 hash) {
+  u64 index = hash & (table->capacity - 1);
+  while (table->entries[index].data != NULL) {
+    String *entry = &table->entries[index];
+    if (table->hashes[index] == hash && entry->length == string.length && memcmp(entry->data, string.data, string.length) == 0) {
+      break;
+    }
+    index = (index + 1) & (table->capacity - 1);
+  }
+  return index;
+}
+
+String InternTableAdd(InternTable *table, String string) {
+  if (StrIsNull(&string)) {
+    return string;
+  }
+
+  if ((table->size + 1) * 2 > table->capacity) {
+    internTableGrow(table);
+  }
+
+  u64 hash = internHash(string);
+  u64 index = internTableFind(table, string, hash);
+  if (table->entries[index].data != NULL) {
+    return table->entries[index];
+  }
+
+  if (table->arena.chunkSize == 0) {
+    table->arena.chunkSize = 64 * 1024;
+  }
+  char *data = ArenaAlloc(&table->arena, string.length + 1);
+  memcpy(data, string.data, string.length);
+  data[string.length] = '\0';
+
+  table->entries[index] = (String){.length = string.length, .data = data};
+  table->hashes[index] = hash;
+  table->size++;
+  return table->entries[index];
+}
+
+// NOTE: Looks the contents up instead of walking the arena chunks, the string is interned when the table's copy is it
+bool InternTableOwns(InternTable *table, String string) {
+  if (string.data == NULL || table->size == 0) {
+    return false;
+  }
+  u64 index = internTableFind(table, string, internHash(string));
+  return table->entries[index].data == string.data;
+}
+
+void InternTableFree(InternTable *table) {
+  free(table->entries);
+  free(table->hashes);
+  ArenaFree(&table->arena);
+  *table = (InternTable){0};
+}
+
+String StrIntern(String string) {
+  return InternTableAdd(&internTable, string);
+}
+
+bool StrIsInterned(String string) {
+  return InternTableOwns(&internTable, string);
+}
+
+#endif
@@ -9,21 +9,28 @@
 #include <dirent.h>
 #include <string.h>
 #include <sys/stat.h>
+#include <utime.h>
 #include <linux/limits.h>
 #include "../base.h"
 #include "../log.h"
 
 String GetCwd() {
-  char *cwd = malloc(PATH_MAX + 1);
+  if (!StrIsNull(&cachedCwd)) {
+    return cachedCwd;
+  }
+
+  char cwd[PATH_MAX + 1];
   if (getcwd(cwd, PATH_MAX) == NULL) {
     LogError("Wasn't able to call getcwd, %d", errno);
     abort();
   }
-  return s(cwd);
+  cachedCwd = StrIntern(s(cwd));
+  return cachedCwd;
 }
 
 void SetCwd(String destination) {
   chdir(destination.data);
+  cachedCwd = (String){0};
 }
 
 Folder *GetDirFiles(String initial) {
@@ -51,18 +58,21 @@ Folder *GetDirFiles(String initial) {
       continue;
     }
     
+    FolderReserve(folder);
     File *currFile = &folder->files[folder->fileCount];
     Folder *currFolder = &folder->folders[folder->folderCount];
     
     if (S_ISDIR(sb.st_mode)) {
-      *currFolder = *GetDirFiles(FormatMalloc("%s/%s", initial.data, entry->d_name));
+      Folder *subfolder = GetDirFiles(FormatMalloc("%s/%s", initial.data, entry->d_name));
+      *currFolder = *subfolder;
+      free(subfolder);
       folder->folderCount++;
     } else if (S_ISREG(sb.st_mode)) {
       char *dot = strrchr(entry->d_name, '.');
       const char *ext = (dot && dot != entry->d_name) ? dot + 1 : "";
       
-      currFile->name = s(strdup(entry->d_name));
-      currFile->extension = strdup(ext);
+      currFile->name = StrNew(entry->d_name);
+      currFile->extension = StrNew((char *)ext).data;
       currFile->size = sb.st_size;
       currFile->modifyTime = sb.st_mtime;
 
@@ -95,33 +105,65 @@ errno_t FileStats(String *path, File *file) {
   char *dot = strrchr(pathCstr, '.');
   const char *ext = (dot && dot != pathCstr) ? dot + 1 : "";
   
-  file->name = s(strdup(pathCstr));
-  file->extension = strdup(ext);
+  file->name = StrNew(pathCstr);
+  file->extension = StrNew((char *)ext).data;
   file->size = sb.st_size;
   file->modifyTime = sb.st_mtime;
 
   return SUCCESS;
 }
 
+errno_t FileModifyTime(String *path, i64 *modifyTime) {
+  struct stat sb;
+
+  if (stat(path->data, &sb) == -1) {
+    if (errno == ENOENT || errno == ENOTDIR)
+      return FILE_NOT_EXIST;
+    LogError("Couldn't stat file %s", path->data);
+    return FILE_GET_ATTRIBUTES_FAILED;
+  }
+
+  *modifyTime = (i64)sb.st_mtim.tv_sec * 1000000000LL + sb.st_mtim.tv_nsec;
+  return SUCCESS;
+}
+
+errno_t FileTouch(String *path) {
+  if (utime(path->data, NULL) != 0) {
+    return FILE_GET_ATTRIBUTES_FAILED;
+  }
+  return SUCCESS;
+}
+
 errno_t FileRead(String *path, String *result) {
-  FILE *file;
-  char buffer[1024];
-  
-  file = fopen(path->data, "r");
+  FILE *file = fopen(path->data, "rb");
   if (file == NULL) {
     if (errno == ENOENT)
       return FILE_NOT_EXIST;
     LogError("Failed to open file: %s", path->data);
     return FILE_OPEN_FAILED;
   }
-  ssize_t charsRead = fread(buffer, sizeof(buffer), sizeof(char), file);
-  *result = StrNew(buffer);
 
-  while (fread(buffer, sizeof(buffer), sizeof(char), file) == 1024) {
-    String stringedBuffer = s(buffer);
-    *result = StrConcat(result, &stringedBuffer);
+  if (fseek(file, 0, SEEK_END) != 0) {
+    fclose(file);
+    return FILE_GET_SIZE_FAILED;
+  }
+  long size = ftell(file);
+  rewind(file);
+  if (size < 0) {
+    fclose(file);
+    return FILE_GET_SIZE_FAILED;
+  }
+
+  char *buffer = malloc(size + 1);
+  if (buffer == NULL) {
+    fclose(file);
+    return MEMORY_ALLOCATION_FAILED;
   }
 
+  size_t charsRead = fread(buffer, sizeof(char), size, file);
+  buffer[charsRead] = '\0';
+  *result = (String){charsRead, buffer};
+
   fclose(file);
   return SUCCESS;
 }
@@ -135,9 +177,9 @@ errno_t FileWrite(String *path, String *data) {
     return FILE_OPEN_FAILED;
   }
 
-  if (fwrite(data->data, data->length, sizeof(char), fp) != data->length) { 
+  if (fwrite(data->data, sizeof(char), data->length, fp) != data->length) {
     fclose(fp);
-    return 1;
+    return FILE_WRITE_FAILED;
   }
   
   fclose(fp);
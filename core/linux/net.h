@@ -0,0 +1,186 @@
+#ifndef LINUX_NET_H
+#define LINUX_NET_H
+
+#ifdef PLATFORM_LINUX
+
+#include <unistd.h>
+#include <errno.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "../base.h"
+#include "../log.h"
+
+// NOTE: No AI_PASSIVE, so an empty host is the loopback address for listeners too. Listening on other interfaces
+// takes an explicit host like "tcp:0.0.0.0:7070"
+static errno_t netResolve(String address, struct addrinfo **result) {
+  char *separator = strrchr(address.data, ':');
+  if (strncmp(address.data, "tcp:", 4) != 0 || separator == NULL || separator < address.data + 4) {
+    LogError("Invalid address %s, use \"unix:/path\" or \"tcp:host:port\"", address.data);
+    return NET_ADDRESS_INVALID;
+  }
+
+  String host = StrNewSize(address.data + 4, separator - address.data - 4);
+  struct addrinfo hints = {0};
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+
+  i32 err = getaddrinfo(host.length == 0 ? NULL : host.data, separator + 1, &hints, result);
+  StrFree(host);
+  if (err != 0) {
+    LogError("Couldn't resolve %s, %s", address.data, gai_strerror(err));
+    return NET_ADDRESS_INVALID;
+  }
+  return SUCCESS;
+}
+
+static errno_t netUnixAddress(String address, struct sockaddr_un *result) {
+  String path = S("");
+  if (strncmp(address.data, "unix:", 5) == 0) {
+    path = s(address.data + 5);
+  }
+
+  if (path.length == 0 || path.length >= sizeof(result->sun_path)) {
+    LogError("Invalid unix socket path in %s", address.data);
+    return NET_ADDRESS_INVALID;
+  }
+
+  memset(result, 0, sizeof(*result));
+  result->sun_family = AF_UNIX;
+  memcpy(result->sun_path, path.data, path.length);
+  return SUCCESS;
+}
+
+errno_t NetListen(String address, Socket *result) {
+  i32 fd = -1;
+
+  if (strncmp(address.data, "unix:", 5) == 0) {
+    struct sockaddr_un unixAddress;
+    errno_t err = netUnixAddress(address, &unixAddress);
+    if (err != SUCCESS) {
+      return err;
+    }
+
+    unlink(unixAddress.sun_path);
+    fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd == -1 || bind(fd, (struct sockaddr *)&unixAddress, sizeof(unixAddress)) != 0) {
+      LogError("Couldn't bind %s, %d", address.data, errno);
+      if (fd != -1) close(fd);
+      return NET_LISTEN_FAILED;
+    }
+  } else {
+    struct addrinfo *info;
+    errno_t err = netResolve(address, &info);
+    if (err != SUCCESS) {
+      return err;
+    }
+
+    fd = socket(info->ai_family, info->ai_socktype, info->ai_protocol);
+    i32 reuse = 1;
+    if (fd != -1) {
+      setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    }
+    if (fd == -1 || bind(fd, info->ai_addr, info->ai_addrlen) != 0) {
+      LogError("Couldn't bind %s, %d", address.data, errno);
+      if (fd != -1) close(fd);
+      freeaddrinfo(info);
+      return NET_LISTEN_FAILED;
+    }
+    freeaddrinfo(info);
+  }
+
+  if (listen(fd, 64) != 0) {
+    LogError("Couldn't listen on %s, %d", address.data, errno);
+    close(fd);
+    return NET_LISTEN_FAILED;
+  }
+
+  *result = fd;
+  return SUCCESS;
+}
+
+errno_t NetAccept(Socket listener, Socket *result) {
+  while (true) {
+    i32 fd = accept((i32)listener, NULL, NULL);
+    if (fd != -1) {
+      *result = fd;
+      return SUCCESS;
+    }
+
+    if (errno != EINTR) {
+      LogError("Couldn't accept a connection, %d", errno);
+      return NET_CONNECT_FAILED;
+    }
+  }
+}
+
+errno_t NetConnect(String address, Socket *result) {
+  i32 fd = -1;
+
+  if (strncmp(address.data, "unix:", 5) == 0) {
+    struct sockaddr_un unixAddress;
+    errno_t err = netUnixAddress(address, &unixAddress);
+    if (err != SUCCESS) {
+      return err;
+    }
+
+    fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd == -1 || connect(fd, (struct sockaddr *)&unixAddress, sizeof(unixAddress)) != 0) {
+      if (fd != -1) close(fd);
+      return NET_CONNECT_FAILED;
+    }
+  } else {
+    struct addrinfo *info;
+    errno_t err = netResolve(address, &info);
+    if (err != SUCCESS) {
+      return err;
+    }
+
+    fd = socket(info->ai_family, info->ai_socktype, info->ai_protocol);
+    if (fd == -1 || connect(fd, info->ai_addr, info->ai_addrlen) != 0) {
+      if (fd != -1) close(fd);
+      freeaddrinfo(info);
+      return NET_CONNECT_FAILED;
+    }
+    freeaddrinfo(info);
+  }
+
+  *result = fd;
+  return SUCCESS;
+}
+
+errno_t NetSend(Socket socket, void *data, size_t length) {
+  u8 *curr = data;
+  while (length > 0) {
+    ssize_t sent = send((i32)socket, curr, length, MSG_NOSIGNAL);
+    if (sent <= 0) {
+      if (sent == -1 && errno == EINTR) continue;
+      return NET_SEND_FAILED;
+    }
+    curr += sent;
+    length -= sent;
+  }
+  return SUCCESS;
+}
+
+errno_t NetReceive(Socket socket, void *data, size_t length) {
+  u8 *curr = data;
+  while (length > 0) {
+    ssize_t received = recv((i32)socket, curr, length, 0);
+    if (received <= 0) {
+      if (received == -1 && errno == EINTR) continue;
+      return NET_RECEIVE_FAILED;
+    }
+    curr += received;
+    length -= received;
+  }
+  return SUCCESS;
+}
+
+void NetClose(Socket socket) {
+  close((i32)socket);
+}
+
+#endif
+
+#endif
@@ -0,0 +1,195 @@
+#ifndef LINUX_PROCESS_H
+#define LINUX_PROCESS_H
+
+#ifdef PLATFORM_LINUX
+
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+#include "../base.h"
+#include "../log.h"
+
+errno_t ProcessSpawn(String command, Process *process) {
+  pid_t pid = fork();
+  if (pid == -1) {
+    LogError("Couldn't fork for command %s, %d", command.data, errno);
+    return PROCESS_SPAWN_FAILED;
+  }
+
+  if (pid == 0) {
+    execl("/bin/sh", "sh", "-c", command.data, (char *)NULL);
+    _exit(127);
+  }
+
+  process->handle = pid;
+  process->exitCode = 0;
+  return SUCCESS;
+}
+
+errno_t ProcessSpawnArguments(StringVector arguments, String outputPath, Process *process) {
+  assert(arguments.length > 0 && "arguments should at least hold the program");
+  char **argv = malloc(sizeof(char *) * (arguments.length + 1));
+  for (size_t i = 0; i < arguments.length; i++) {
+    argv[i] = VecAt(arguments, i)->data;
+  }
+  argv[arguments.length] = NULL;
+
+  fflush(stdout);
+  pid_t pid = fork();
+  if (pid == -1) {
+    LogError("Couldn't fork for %s, %d", argv[0], errno);
+    free(argv);
+    return PROCESS_SPAWN_FAILED;
+  }
+
+  if (pid == 0) {
+    i32 fd = open(outputPath.data, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd == -1) {
+      _exit(127);
+    }
+    dup2(fd, STDOUT_FILENO);
+    dup2(fd, STDERR_FILENO);
+    close(fd);
+    execvp(argv[0], argv);
+    _exit(127);
+  }
+
+  free(argv);
+  process->handle = pid;
+  process->exitCode = 0;
+  return SUCCESS;
+}
+
+errno_t ProcessFork(i32 (*function)(void *), void *argument, Process *process) {
+  fflush(stdout);
+  pid_t pid = fork();
+  if (pid == -1) {
+    LogError("Couldn't fork, %d", errno);
+    return PROCESS_SPAWN_FAILED;
+  }
+
+  if (pid == 0) {
+    i32 result = function(argument);
+    fflush(stdout);
+    _exit(result);
+  }
+
+  process->handle = pid;
+  process->exitCode = 0;
+  return SUCCESS;
+}
+
+void ProcessReapFinished() {
+  while (waitpid(-1, NULL, WNOHANG) > 0) {
+  }
+}
+
+// NOTE: /proc files report a size of 0, so this can't go through FileRead
+StringVector ProcessArguments() {
+  StringVector result = {0};
+  FILE *file = fopen("/proc/self/cmdline", "rb");
+  if (file == NULL) {
+    LogError("Couldn't read the current arguments");
+    return result;
+  }
+
+  size_t length = 0;
+  size_t capacity = 4096;
+  char *cmdline = malloc(capacity);
+  size_t read;
+  while ((read = fread(cmdline + length, 1, capacity - length, file)) > 0) {
+    length += read;
+    if (length == capacity) {
+      capacity *= 2;
+      cmdline = realloc(cmdline, capacity);
+    }
+  }
+  fclose(file);
+
+  for (size_t i = 0; i < length; i += strlen(cmdline + i) + 1) {
+    VecPush(result, s(cmdline + i));
+  }
+  return result;
+}
+
+errno_t ProcessWait(Process *processes, size_t count, size_t *finished) {
+  while (true) {
+    i32 status;
+    struct rusage usage;
+    pid_t pid = wait4(-1, &status, 0, &usage);
+    if (pid == -1) {
+      if (errno == EINTR) {
+        continue;
+      }
+      LogError("Couldn't wait for child processes, %d", errno);
+      return PROCESS_WAIT_FAILED;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+      if (processes[i].handle != pid) {
+        continue;
+      }
+      processes[i].exitCode = WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+      processes[i].cpuTime = (i64)(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000 + usage.ru_utime.tv_usec + usage.ru_stime.tv_usec;
+      processes[i].peakMemory = usage.ru_maxrss;
+      *finished = i;
+      return SUCCESS;
+    }
+  }
+}
+
+errno_t ProcessRestart(String exe) {
+  StringVector arguments = ProcessArguments();
+  size_t argc = arguments.length == 0 ? 1 : arguments.length;
+  char **argv = malloc(sizeof(char *) * (argc + 1));
+  for (size_t i = 0; i < arguments.length; i++) {
+    argv[i] = VecAt(arguments, i)->data;
+  }
+  argv[0] = exe.data;
+  argv[argc] = NULL;
+
+  fflush(stdout);
+  execv(exe.data, argv);
+  LogError("Couldn't exec %s, %d", exe.data, errno);
+  free(argv);
+  return PROCESS_SPAWN_FAILED;
+}
+
+i32 ProcessorCount() {
+  long count = sysconf(_SC_NPROCESSORS_ONLN);
+  return count > 0 ? (i32)count : 1;
+}
+
+bool FindExecutable(String name) {
+  char *path = getenv("PATH");
+  if (path == NULL) {
+    return false;
+  }
+
+  char candidate[4096];
+  char *start = path;
+  while (true) {
+    char *end = strchr(start, ':');
+    size_t len = end == NULL ? strlen(start) : (size_t)(end - start);
+    if (len == 0) {
+      snprintf(candidate, sizeof(candidate), "./%s", name.data);
+    } else {
+      snprintf(candidate, sizeof(candidate), "%.*s/%s", (int)len, start, name.data);
+    }
+
+    if (access(candidate, X_OK) == 0) {
+      return true;
+    }
+
+    if (end == NULL) {
+      return false;
+    }
+    start = end + 1;
+  }
+}
+
+#endif
+
+#endif
@@ -8,6 +8,7 @@
 #ifdef PLATFORM_LINUX
 
 #define CLOCK_REALTIME			0
+#define CLOCK_MONOTONIC			1
 
 i64 TimeNow() {
   struct timespec ts;
@@ -17,6 +18,12 @@ i64 TimeNow() {
   return currentTime;
 }
 
+i64 TimeNanoseconds() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
 void WaitTime(i64 ms) {
   struct timespec ts;
   ts.tv_sec = ms / 1000;
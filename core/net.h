@@ -0,0 +1,30 @@
+#ifndef NET_H
+#define NET_H
+
+#include "str.h"
+
+#ifdef PLATFORM_LINUX // NOTE: Only the build workers use sockets, they are linux only
+
+typedef i64 Socket;
+
+enum NetError {
+  NET_ADDRESS_INVALID = 1,
+  NET_CONNECT_FAILED,
+  NET_LISTEN_FAILED,
+  NET_SEND_FAILED,
+  NET_RECEIVE_FAILED,
+};
+
+// NOTE: Addresses are "unix:/path/to/socket" or "tcp:host:port", "tcp::port" is the loopback address
+errno_t NetListen(String address, Socket *result);
+errno_t NetAccept(Socket listener, Socket *result);
+errno_t NetConnect(String address, Socket *result);
+errno_t NetSend(Socket socket, void *data, size_t length);
+errno_t NetReceive(Socket socket, void *data, size_t length); // NOTE: Blocks until all of `length` arrived
+void NetClose(Socket socket);
+
+#include "linux/net.h"
+
+#endif
+
+#endif
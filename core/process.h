@@ -0,0 +1,38 @@
+#ifndef PROCESS_H
+#define PROCESS_H
+
+#include "str.h"
+
+typedef struct {
+  i64 handle;
+  i32 exitCode;
+  i64 cpuTime;    // NOTE: Microseconds of user and system time, set by ProcessWait
+  i64 peakMemory; // NOTE: Peak resident set in kilobytes, set by ProcessWait
+} Process;
+
+enum ProcessError {
+  PROCESS_SPAWN_FAILED = 1,
+  PROCESS_WAIT_FAILED,
+};
+
+errno_t ProcessSpawn(String command, Process *process); // NOTE: Runs `command` through the platform shell
+errno_t ProcessWait(Process *processes, size_t count, size_t *finished); // NOTE: Waits for any of `processes` and collects its resource usage
+void ProcessReapFinished(); // NOTE: Collects finished children nobody waits for
+StringVector ProcessArguments();
+errno_t ProcessRestart(String exe); // NOTE: Re-runs the current arguments as `exe`, doesn't return on success
+i32 ProcessorCount();
+bool FindExecutable(String name); // NOTE: Searches `PATH`
+
+#ifdef PLATFORM_LINUX // NOTE: Only the build workers use these
+errno_t ProcessSpawnArguments(StringVector arguments, String outputPath, Process *process); // NOTE: No shell, `arguments[0]` is searched in `PATH`, stdout and stderr go to `outputPath`
+errno_t ProcessFork(i32 (*function)(void *), void *argument, Process *process); // NOTE: The child exits with what `function` returns
+#endif
+
+#ifdef PLATFORM_WIN
+# include "windows/process.h"
+#endif
+#ifdef PLATFORM_LINUX
+# include "linux/process.h"
+#endif
+
+#endif
@@ -2,7 +2,9 @@
 #define STRING_H
 
 #include <stdbool.h>
+#include "arena.h"
 #include "base.h"
+#include "strscan.h"
 #include "vectors.h"
 
 typedef struct {
@@ -21,6 +23,10 @@ typedef struct {
 
 String s(char *msg);
 
+// NOTE: While set, every String made here comes from `arena` and StrFree does nothing, NULL goes back to malloc.
+// Returns the arena that was set before
+Arena *StrSetArena(Arena *arena);
+
 String FormatMalloc(const char *format, ...) FORMAT_CHECK(2, 3);
 
 errno_t memcpy_s(void *dest, size_t destSize, const void *src, size_t count);
@@ -43,17 +49,50 @@ String StrNew(char *str);
 String StrNewSize(char *str, size_t len); // Without null terminator
 void StrCopy(String *destination, String *source);
 StringVector StrSplit(String *string, String *delimiter);
+StringVector StrSplitView(String *string, String *delimiter); // NOTE: Pieces point into `string`, free only the vector
 bool StrEqual(String string1, String string2);
 String StrConcat(String *string1, String *string2);
 void StrToUpper(String *string1);
 void StrToLower(String *string1);
 bool StrIsNull(String *string);
 void StrTrim(String *string);
-void StrFree(String string);
+void StrFree(String string); // NOTE: Does nothing while an arena is set, leaves interned strings alone
+bool StrIsInterned(String string); // NOTE: Implemented in intern.h
 String StrSlice(String *str, i32 start, i32 end);
-String ConvertExe(String path);
-String ConvertPath(String path);
-String ParsePath(String path);
+
+// NOTE: Non owning window into a String or a literal, none of the StrView functions allocate and `data` isn't null
+// terminated. StrViewToString is where a view becomes a String of its own
+typedef struct {
+  size_t length;
+  const char *data;
+} StrView;
+
+// NOTE: `SV` is `S` for views, string literals only
+#define SV(string) (TYPE_INIT(StrView){.length = STRING_LENGTH(ENSURE_STRING_LITERAL(string)), .data = (string)})
+
+StrView StrViewOf(String string);
+StrView StrViewSlice(StrView view, size_t start, size_t end);
+bool StrViewEqual(StrView view1, StrView view2);
+bool StrViewStartsWith(StrView view, StrView prefix);
+bool StrViewEndsWith(StrView view, StrView suffix);
+String StrViewToString(StrView view);
+
+StrView ParsePath(StrView path); // NOTE: Without a leading `./`, points into `path`
+String ConvertPath(StrView path); // NOTE: ParsePath with the platform's separators, the one allocation
+String ConvertExe(StrView path); // NOTE: ConvertPath with the platform's executable extension added or dropped
+
+// NOTE: Growable buffer for output built piece by piece, appends are amortized O(1) and data stays null terminated
+typedef struct {
+  size_t length;
+  size_t capacity;
+  char *data;
+} StrBuilder;
+
+StrBuilder StrBuilderNew(size_t capacity);
+void StrBuilderAppend(StrBuilder *builder, String string);
+void StrBuilderAppendFormat(StrBuilder *builder, const char *format, ...) FORMAT_CHECK(2, 3);
+String StrBuilderToString(StrBuilder *builder); // NOTE: The builder is empty afterwards
+void StrBuilderFree(StrBuilder *builder);
 
 errno_t memcpy_s(void *dest, size_t destSize, const void *src, size_t count) {
   if (dest == NULL) {
@@ -70,6 +109,18 @@ errno_t memcpy_s(void *dest, size_t destSize, const void *src, size_t count) {
 }
 
 /* String Implementation */
+static Arena *strArena = NULL;
+
+Arena *StrSetArena(Arena *arena) {
+  Arena *previous = strArena;
+  strArena = arena;
+  return previous;
+}
+
+static char *strAlloc(size_t size) {
+  return strArena != NULL ? (char *)ArenaAlloc(strArena, size) : (char *)malloc(size);
+}
+
 static void addNullTerminator(char *str, size_t len) {
   str[len] = '\0';
 }
@@ -79,10 +130,9 @@ bool StrIsNull(String *str) {
 }
 
 String StrNewSize(char *str, size_t len) {
-  const size_t memorySize = sizeof(char) * len + 1; // NOTE: Includes null terminator
-  char *allocatedString = (char *)malloc(memorySize);
+  char *allocatedString = strAlloc(sizeof(char) * len + 1); // NOTE: Includes null terminator
 
-  memcpy(allocatedString, str, memorySize);
+  memcpy(allocatedString, str, len); // NOTE: `str` may be a view into a bigger buffer, reading its byte `len` runs past the end
   addNullTerminator(allocatedString, len);
   return (String){len, allocatedString};
 }
@@ -95,10 +145,9 @@ String StrNew(char *str) {
   if (len == 0) {
     return (String){0, NULL};
   }
-  const size_t memorySize = sizeof(char) * len + 1; // NOTE: Includes null terminator
-  char *allocatedString = (char *)malloc(memorySize);
+  char *allocatedString = strAlloc(sizeof(char) * len + 1); // NOTE: Includes null terminator
 
-  memcpy(allocatedString, str, memorySize);
+  memcpy(allocatedString, str, len); // NOTE: `str` may be a view into a bigger buffer, reading its byte `len` runs past the end
   addNullTerminator(allocatedString, len);
   return (String){len, allocatedString};
 }
@@ -116,7 +165,7 @@ String StrConcat(String *string1, String *string2) {
 
   const size_t len = string1->length + string2->length;
   const size_t memorySize = sizeof(char) * len + 1; // NOTE: Includes null terminator
-  char *allocatedString = (char *)malloc(memorySize);
+  char *allocatedString = strAlloc(memorySize);
 
   memcpy_s(allocatedString, memorySize, string1->data, string1->length);
   memcpy_s(allocatedString + string1->length, memorySize, string2->data, string2->length);
@@ -141,53 +190,49 @@ bool StrEqual(String string1, String string2) {
     return false;
   }
 
+  if (string1.data == string2.data) {
+    return true; // NOTE: Always the case for equal interned strings
+  }
+
   if (memcmp(string1.data, string2.data, string1.length) != 0) {
     return false;
   }
   return true;
 }
 
-StringVector StrSplit(String *str, String *delimiter) {
+// NOTE: Pieces either own a copy or point into `str`, StrSplitView's pieces aren't null terminated
+static StringVector strSplit(String *str, String *delimiter, bool copy) {
   assert(!StrIsNull(str) && "str should never be NULL");
   assert(!StrIsNull(delimiter) && "delimiter should never be NULL");
 
-  char *start = str->data;
-  const char *end = str->data + str->length;
-  char *curr = start;
   StringVector result = {0};
   if (delimiter->length == 0) {
     for (size_t i = 0; i < str->length; i++) {
-      String currString = StrNewSize(str->data + i, 1);
+      String currString = copy ? StrNewSize(str->data + i, 1) : (String){.length = 1, .data = str->data + i};
       VecPush(result, currString);
     }
     return result;
   }
 
-  while (curr < end) {
-    char *match = NULL;
-    for (char *search = curr; search <= end - delimiter->length; search++) {
-      if (memcmp(search, delimiter->data, delimiter->length) == 0) {
-        match = search;
-        break;
-      }
-    }
-
-    if (!match) {
-      String currString = StrNewSize(curr, end - curr);
-      VecPush(result, currString);
-      break;
-    }
-
-    size_t len = match - curr;
-    String currString = StrNewSize(curr, len);
+  size_t curr = 0;
+  while (curr < str->length) {
+    size_t len = StrScanNeedle(str->data + curr, str->length - curr, delimiter->data, delimiter->length);
+    String currString = copy ? StrNewSize(str->data + curr, len) : (String){.length = len, .data = str->data + curr};
     VecPush(result, currString);
-
-    curr = match + delimiter->length;
+    curr += len + delimiter->length;
   }
 
   return result;
 }
 
+StringVector StrSplit(String *str, String *delimiter) {
+  return strSplit(str, delimiter, true);
+}
+
+StringVector StrSplitView(String *str, String *delimiter) {
+  return strSplit(str, delimiter, false);
+}
+
 void StringToUpper(String *str) {
   for (int i = 0; i < str->length; ++i) {
     char currChar = str->data[i];
@@ -202,46 +247,14 @@ void StrToLower(String *str) {
   }
 }
 
-bool isSpace(char character) {
-  return character == ' ' || character == '\n' || character == '\t' || character == '\r';
-}
-
 void StrTrim(String *str) {
-  char *firstChar = NULL;
-  char *lastChar = NULL;
   if (str->length == 0) {
     return;
   }
 
-  if (str->length == 1) {
-    if (isSpace(str->data[0])) {
-      str->data[0] = '\0';
-      str->length = 0;
-    }
-    return;
-  }
-
-  for (int i = 0; i < str->length; ++i) {
-    char *currChar = &str->data[i];
-    if (isSpace(*currChar)) {
-      continue;
-    }
-
-    if (firstChar == NULL) {
-      firstChar = currChar;
-    }
-    lastChar = currChar;
-  }
-
-  if (firstChar == NULL || lastChar == NULL) {
-    str->data[0] = '\0';
-    str->length = 0;
-    addNullTerminator(str->data, 0);
-    return;
-  }
-
-  size_t len = (lastChar - firstChar) + 1;
-  memcpy_s(str->data, str->length, firstChar, len);
+  size_t first = StrScanNotAny(str->data, str->length, " \n\t\r");
+  size_t len = first == str->length ? 0 : StrScanNotAnyBack(str->data, str->length, " \n\t\r") - first;
+  memmove(str->data, str->data + first, len);
   str->length = len;
   addNullTerminator(str->data, len);
 }
@@ -254,14 +267,41 @@ String StrSlice(String *str, i32 start, i32 end) {
     end = str->length + end;
   }
 
+  return StrViewToString(StrViewSlice(StrViewOf(*str), start, end));
+}
+
+StrView StrViewOf(String string) {
+  return (StrView){.length = string.length, .data = string.data};
+}
+
+StrView StrViewSlice(StrView view, size_t start, size_t end) {
   assert(end >= start && "end must be greater than or equal to start");
-  assert(end <= str->length && "end index out of bounds");
+  assert(end <= view.length && "end index out of bounds");
+  return (StrView){.length = end - start, .data = view.data + start};
+}
+
+bool StrViewEqual(StrView view1, StrView view2) {
+  return view1.length == view2.length && (view1.data == view2.data || memcmp(view1.data, view2.data, view1.length) == 0);
+}
+
+bool StrViewStartsWith(StrView view, StrView prefix) {
+  return view.length >= prefix.length && memcmp(view.data, prefix.data, prefix.length) == 0;
+}
+
+bool StrViewEndsWith(StrView view, StrView suffix) {
+  return view.length >= suffix.length && memcmp(view.data + view.length - suffix.length, suffix.data, suffix.length) == 0;
+}
 
-  size_t len = end - start;
-  return StrNewSize(str->data + start, len);
+String StrViewToString(StrView view) {
+  return StrNewSize((char *)view.data, view.length);
 }
 
+// NOTE: Telling arena strings from malloc'd ones would walk every chunk on each free, so while an arena is set
+// nothing is freed one by one. The arena takes its strings back at once, FileFreeContent covers FileRead's buffers
 void StrFree(String string) {
+  if (string.data == NULL || strArena != NULL || StrIsInterned(string)) {
+    return;
+  }
   free(string.data);
 }
 
@@ -271,7 +311,7 @@ String FormatMalloc(const char *format, ...) {
   size_t size = vsnprintf(NULL, 0, format, args) + 1; // +1 for null terminator
   va_end(args);
 
-  char *buffer = (char *)malloc(size);
+  char *buffer = strAlloc(size);
   va_start(args, format);
   vsnprintf(buffer, size, format, args);
   va_end(args);
@@ -279,16 +319,85 @@ String FormatMalloc(const char *format, ...) {
   return (String){.length = size - 1, .data = buffer};
 }
 
-String ConvertPath(String path) {
-  String platform = GetPlatform();
-  String result;
+StrBuilder StrBuilderNew(size_t capacity) {
+  capacity = capacity < 16 ? 16 : capacity;
+  char *data = (char *)malloc(capacity);
+  addNullTerminator(data, 0);
+  return (StrBuilder){.length = 0, .capacity = capacity, .data = data};
+}
+
+static void strBuilderReserve(StrBuilder *builder, size_t extra) {
+  size_t needed = builder->length + extra + 1; // NOTE: Includes null terminator
+  if (needed <= builder->capacity) {
+    return;
+  }
+
+  size_t capacity = builder->capacity < 16 ? 16 : builder->capacity;
+  while (capacity < needed) {
+    capacity *= 2;
+  }
+  builder->data = (char *)realloc(builder->data, capacity);
+  builder->capacity = capacity;
+}
+
+void StrBuilderAppend(StrBuilder *builder, String string) {
+  if (string.length == 0) {
+    return;
+  }
+  strBuilderReserve(builder, string.length);
+  memcpy(builder->data + builder->length, string.data, string.length);
+  builder->length += string.length;
+  addNullTerminator(builder->data, builder->length);
+}
+
+void StrBuilderAppendFormat(StrBuilder *builder, const char *format, ...) {
+  strBuilderReserve(builder, 0);
+
+  // NOTE: Formats straight into the spare capacity, only a result that doesn't fit is formatted twice
+  va_list args;
+  va_start(args, format);
+  size_t available = builder->capacity - builder->length;
+  size_t written = vsnprintf(builder->data + builder->length, available, format, args);
+  va_end(args);
 
-  if (path.length >= 2 && path.data[0] == '.' && (path.data[1] == '/' || path.data[1] == '\\')) {
-    result = StrNewSize(path.data + 2, path.length - 2);
-    memcpy(result.data, path.data + 2, path.length - 2);
-  } else {
-    result = StrNewSize(path.data, path.length);
+  if (written >= available) {
+    strBuilderReserve(builder, written);
+    va_start(args, format);
+    vsnprintf(builder->data + builder->length, written + 1, format, args);
+    va_end(args);
   }
+  builder->length += written;
+}
+
+String StrBuilderToString(StrBuilder *builder) {
+  String result = {.length = builder->length, .data = builder->data};
+  if (strArena != NULL) {
+    result = StrNewSize(builder->data, builder->length); // NOTE: Owned like every other String, the buffer goes back right away
+    free(builder->data);
+  }
+  *builder = (StrBuilder){0};
+  return result;
+}
+
+void StrBuilderFree(StrBuilder *builder) {
+  free(builder->data);
+  *builder = (StrBuilder){0};
+}
+
+StrView ParsePath(StrView path) {
+  if (StrViewStartsWith(path, SV("./")) || StrViewStartsWith(path, SV(".\\"))) {
+    return StrViewSlice(path, 2, path.length);
+  }
+  return path;
+}
+
+// NOTE: Copies `path` and `suffix` into a single allocation and fixes the separators in place
+static String convertPath(StrView path, StrView suffix) {
+  String platform = GetPlatform();
+  String result = {.length = path.length + suffix.length, .data = strAlloc(path.length + suffix.length + 1)};
+  memcpy(result.data, path.data, path.length);
+  memcpy(result.data + path.length, suffix.data, suffix.length);
+  addNullTerminator(result.data, result.length);
 
   if (StrEqual(platform, S("linux")) || StrEqual(platform, S("macos"))) {
     return result;
@@ -303,46 +412,24 @@ String ConvertPath(String path) {
   return result;
 }
 
-String ParsePath(String path) {
-  String result;
-
-  if (path.length >= 2 && path.data[0] == '.' && (path.data[1] == '/' || path.data[1] == '\\')) {
-    result = StrNewSize(path.data + 2, path.length - 2);
-    memcpy(result.data, path.data + 2, path.length - 2);
-  } else {
-    result = StrNewSize(path.data, path.length);
-  }
-
-  return result;
+String ConvertPath(StrView path) {
+  return convertPath(ParsePath(path), SV(""));
 }
 
-String ConvertExe(String path) {
+String ConvertExe(StrView path) {
   String platform = GetPlatform();
-  String exeExtension = S(".exe");
-
-  bool hasExe = false;
-  if (path.length >= exeExtension.length) {
-    String pathEnd = StrSlice(&path, path.length - exeExtension.length, path.length);
-    if (StrEqual(pathEnd, exeExtension)) {
-      hasExe = true;
-    }
-  }
+  StrView exeExtension = SV(".exe");
+  bool hasExe = StrViewEndsWith(path, exeExtension);
 
-  if (StrEqual(platform, S("windows"))) {
-    if (hasExe) {
-      return path;
-    }
-    return StrConcat(&path, &exeExtension);
+  if (StrEqual(platform, S("windows")) && !hasExe) {
+    return convertPath(ParsePath(path), exeExtension);
   }
 
-  if (StrEqual(platform, S("linux")) || StrEqual(platform, S("macos"))) {
-    if (hasExe) {
-      return StrSlice(&path, 0, path.length - exeExtension.length);
-    }
-    return path;
+  if ((StrEqual(platform, S("linux")) || StrEqual(platform, S("macos"))) && hasExe) {
+    path = StrViewSlice(path, 0, path.length - exeExtension.length);
   }
 
-  return path;
+  return ConvertPath(path);
 }
 
 #endif
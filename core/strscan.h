@@ -0,0 +1,281 @@
+#ifndef STRSCAN_H
+#define STRSCAN_H
+
+#include "base.h"
+
+// NOTE: Byte scans behind StrSplit, StrTrim and the log and depfile parsers. They compare 16 (SSE2) or 32 (AVX2) bytes
+// at once, AVX2 is picked at runtime when the CPU has it. Every scan returns `length` when nothing matches.
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define STRSCAN_SSE2
+#include <emmintrin.h>
+#endif
+
+#if defined(STRSCAN_SSE2) && (defined(COMPILER_GCC) || defined(COMPILER_CLANG)) && (defined(__x86_64__) || defined(__i386__))
+#define STRSCAN_AVX2 // NOTE: MSVC builds stay on SSE2, they have no per function target attribute
+#include <immintrin.h>
+#endif
+
+#ifdef COMPILER_MSVC
+#include <intrin.h>
+#endif
+
+typedef enum {
+  STRSCAN_SCALAR,
+  STRSCAN_SSE2_LEVEL,
+  STRSCAN_AVX2_LEVEL,
+} StrScanLevel;
+
+size_t StrScanAny(const char *data, size_t length, const char *set); // NOTE: First byte that is in `set`, up to 8 bytes
+size_t StrScanNotAny(const char *data, size_t length, const char *set); // NOTE: First byte that isn't in `set`
+size_t StrScanNotAnyBack(const char *data, size_t length, const char *set); // NOTE: Length without the trailing bytes in `set`
+size_t StrScanNeedle(const char *data, size_t length, const char *needle, size_t needleLength);
+StrScanLevel StrScanUseLevel(StrScanLevel level); // NOTE: Caps the instruction set for benchmarks, returns the one in use
+
+#define STRSCAN_MAX_SET 8
+
+static StrScanLevel strScanLevel = STRSCAN_SCALAR;
+static bool strScanDetected = false;
+
+static u32 strScanLowestBit(u32 mask) {
+#ifdef COMPILER_MSVC
+  unsigned long index;
+  _BitScanForward(&index, mask);
+  return (u32)index;
+#else
+  return (u32)__builtin_ctz(mask);
+#endif
+}
+
+static u32 strScanHighestBit(u32 mask) {
+#ifdef COMPILER_MSVC
+  unsigned long index;
+  _BitScanReverse(&index, mask);
+  return (u32)index;
+#else
+  return 31 - (u32)__builtin_clz(mask);
+#endif
+}
+
+static bool strScanInSet(char c, const char *set, size_t count) {
+  for (size_t i = 0; i < count; i++) {
+    if (c == set[i]) {
+      return true;
+    }
+  }
+  return false;
+}
+
+static size_t strScanAnyScalar(const char *data, size_t length, const char *set, size_t count, bool invert) {
+  for (size_t i = 0; i < length; i++) {
+    if (strScanInSet(data[i], set, count) != invert) {
+      return i;
+    }
+  }
+  return length;
+}
+
+static size_t strScanNeedleScalar(const char *data, size_t length, const char *needle, size_t needleLength) {
+  for (size_t i = 0; i + needleLength <= length; i++) {
+    if (data[i] == needle[0] && memcmp(data + i, needle, needleLength) == 0) {
+      return i;
+    }
+  }
+  return length;
+}
+
+#ifdef STRSCAN_SSE2
+static size_t strScanAnySse2(const char *data, size_t length, const char *set, size_t count, bool invert) {
+  __m128i bytes[STRSCAN_MAX_SET];
+  for (size_t i = 0; i < count; i++) {
+    bytes[i] = _mm_set1_epi8(set[i]);
+  }
+
+  size_t i = 0;
+  for (; i + 16 <= length; i += 16) {
+    __m128i chunk = _mm_loadu_si128((const __m128i *)(data + i));
+    __m128i hits = _mm_setzero_si128();
+    for (size_t j = 0; j < count; j++) {
+      hits = _mm_or_si128(hits, _mm_cmpeq_epi8(chunk, bytes[j]));
+    }
+    u32 mask = (u32)_mm_movemask_epi8(hits) ^ (invert ? 0xFFFFu : 0);
+    if (mask != 0) {
+      return i + strScanLowestBit(mask);
+    }
+  }
+  return i + strScanAnyScalar(data + i, length - i, set, count, invert);
+}
+
+static size_t strScanNotAnyBackSse2(const char *data, size_t length, const char *set, size_t count) {
+  __m128i bytes[STRSCAN_MAX_SET];
+  for (size_t i = 0; i < count; i++) {
+    bytes[i] = _mm_set1_epi8(set[i]);
+  }
+
+  size_t end = length;
+  while (end >= 16) {
+    __m128i chunk = _mm_loadu_si128((const __m128i *)(data + end - 16));
+    __m128i hits = _mm_setzero_si128();
+    for (size_t j = 0; j < count; j++) {
+      hits = _mm_or_si128(hits, _mm_cmpeq_epi8(chunk, bytes[j]));
+    }
+    u32 mask = (u32)_mm_movemask_epi8(hits) ^ 0xFFFFu;
+    if (mask != 0) {
+      return end - 16 + strScanHighestBit(mask) + 1;
+    }
+    end -= 16;
+  }
+  while (end > 0 && strScanInSet(data[end - 1], set, count)) {
+    end--;
+  }
+  return end;
+}
+
+// NOTE: Compares the needle's first and last byte at 16 offsets at once, only offsets where both match get a memcmp
+static size_t strScanNeedleSse2(const char *data, size_t length, const char *needle, size_t needleLength) {
+  __m128i first = _mm_set1_epi8(needle[0]);
+  __m128i last = _mm_set1_epi8(needle[needleLength - 1]);
+  size_t i = 0;
+  for (; i + needleLength - 1 + 16 <= length; i += 16) {
+    __m128i firstBlock = _mm_loadu_si128((const __m128i *)(data + i));
+    __m128i lastBlock = _mm_loadu_si128((const __m128i *)(data + i + needleLength - 1));
+    u32 mask = (u32)_mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(firstBlock, first), _mm_cmpeq_epi8(lastBlock, last)));
+    for (; mask != 0; mask &= mask - 1) {
+      size_t offset = i + strScanLowestBit(mask);
+      if (needleLength <= 2 || memcmp(data + offset + 1, needle + 1, needleLength - 2) == 0) {
+        return offset;
+      }
+    }
+  }
+  size_t rest = strScanNeedleScalar(data + i, length - i, needle, needleLength);
+  return rest == length - i ? length : i + rest;
+}
+#endif
+
+#ifdef STRSCAN_AVX2
+__attribute__((target("avx2"))) static size_t strScanAnyAvx2(const char *data, size_t length, const char *set, size_t count, bool invert) {
+  __m256i bytes[STRSCAN_MAX_SET];
+  for (size_t i = 0; i < count; i++) {
+    bytes[i] = _mm256_set1_epi8(set[i]);
+  }
+
+  size_t i = 0;
+  for (; i + 32 <= length; i += 32) {
+    __m256i chunk = _mm256_loadu_si256((const __m256i *)(data + i));
+    __m256i hits = _mm256_setzero_si256();
+    for (size_t j = 0; j < count; j++) {
+      hits = _mm256_or_si256(hits, _mm256_cmpeq_epi8(chunk, bytes[j]));
+    }
+    u32 mask = (u32)_mm256_movemask_epi8(hits) ^ (invert ? 0xFFFFFFFFu : 0);
+    if (mask != 0) {
+      return i + strScanLowestBit(mask);
+    }
+  }
+  return i + strScanAnySse2(data + i, length - i, set, count, invert);
+}
+
+__attribute__((target("avx2"))) static size_t strScanNeedleAvx2(const char *data, size_t length, const char *needle, size_t needleLength) {
+  __m256i first = _mm256_set1_epi8(needle[0]);
+  __m256i last = _mm256_set1_epi8(needle[needleLength - 1]);
+  size_t i = 0;
+  for (; i + needleLength - 1 + 32 <= length; i += 32) {
+    __m256i firstBlock = _mm256_loadu_si256((const __m256i *)(data + i));
+    __m256i lastBlock = _mm256_loadu_si256((const __m256i *)(data + i + needleLength - 1));
+    u32 mask = (u32)_mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(firstBlock, first), _mm256_cmpeq_epi8(lastBlock, last)));
+    for (; mask != 0; mask &= mask - 1) {
+      size_t offset = i + strScanLowestBit(mask);
+      if (needleLength <= 2 || memcmp(data + offset + 1, needle + 1, needleLength - 2) == 0) {
+        return offset;
+      }
+    }
+  }
+  size_t rest = strScanNeedleSse2(data + i, length - i, needle, needleLength);
+  return rest == length - i ? length : i + rest;
+}
+#endif
+
+static StrScanLevel strScanSupportedLevel() {
+#if defined(STRSCAN_AVX2)
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("avx2") ? STRSCAN_AVX2_LEVEL : STRSCAN_SSE2_LEVEL;
+#elif defined(STRSCAN_SSE2)
+  return STRSCAN_SSE2_LEVEL;
+#else
+  return STRSCAN_SCALAR;
+#endif
+}
+
+static StrScanLevel strScanCurrentLevel() {
+  if (!strScanDetected) {
+    strScanLevel = strScanSupportedLevel();
+    strScanDetected = true;
+  }
+  return strScanLevel;
+}
+
+StrScanLevel StrScanUseLevel(StrScanLevel level) {
+  StrScanLevel supported = strScanSupportedLevel();
+  strScanLevel = level < supported ? level : supported;
+  strScanDetected = true;
+  return strScanLevel;
+}
+
+static size_t strScanSet(const char *data, size_t length, const char *set, bool invert) {
+  size_t count = strlen(set);
+  assert(count > 0 && count <= STRSCAN_MAX_SET && "set should have 1 to 8 bytes");
+  switch (strScanCurrentLevel()) {
+#ifdef STRSCAN_AVX2
+  case STRSCAN_AVX2_LEVEL:
+    return strScanAnyAvx2(data, length, set, count, invert);
+#endif
+#ifdef STRSCAN_SSE2
+  case STRSCAN_SSE2_LEVEL:
+    return strScanAnySse2(data, length, set, count, invert);
+#endif
+  default:
+    return strScanAnyScalar(data, length, set, count, invert);
+  }
+}
+
+size_t StrScanAny(const char *data, size_t length, const char *set) {
+  return strScanSet(data, length, set, false);
+}
+
+size_t StrScanNotAny(const char *data, size_t length, const char *set) {
+  return strScanSet(data, length, set, true);
+}
+
+size_t StrScanNotAnyBack(const char *data, size_t length, const char *set) {
+  size_t count = strlen(set);
+  assert(count > 0 && count <= STRSCAN_MAX_SET && "set should have 1 to 8 bytes");
+#ifdef STRSCAN_SSE2
+  if (strScanCurrentLevel() != STRSCAN_SCALAR) {
+    return strScanNotAnyBackSse2(data, length, set, count);
+  }
+#endif
+  size_t end = length;
+  while (end > 0 && strScanInSet(data[end - 1], set, count)) {
+    end--;
+  }
+  return end;
+}
+
+size_t StrScanNeedle(const char *data, size_t length, const char *needle, size_t needleLength) {
+  if (needleLength == 0 || needleLength > length) {
+    return needleLength == 0 ? 0 : length;
+  }
+
+  switch (strScanCurrentLevel()) {
+#ifdef STRSCAN_AVX2
+  case STRSCAN_AVX2_LEVEL:
+    return strScanNeedleAvx2(data, length, needle, needleLength);
+#endif
+#ifdef STRSCAN_SSE2
+  case STRSCAN_SSE2_LEVEL:
+    return strScanNeedleSse2(data, length, needle, needleLength);
+#endif
+  default:
+    return strScanNeedleScalar(data, length, needle, needleLength);
+  }
+}
+
+#endif
@@ -6,22 +6,28 @@
 #ifdef PLATFORM_WIN
 
 #include <windows.h>
+#include <sys/utime.h>
 
 String GetCwd() {
-  char *currentPath = malloc(MAX_PATH + 1);
+  if (!StrIsNull(&cachedCwd)) {
+    return cachedCwd;
+  }
+
+  char currentPath[MAX_PATH + 1];
   DWORD length = GetCurrentDirectory(MAX_PATH, currentPath);
   if (length == 0) {
     LogError("Error getting current directory: %lu\n", GetLastError());
     abort();
   }
-  return s(currentPath);
+  cachedCwd = StrIntern(s(currentPath));
+  return cachedCwd;
 }
 void SetCwd(String destination) {
   bool result = SetCurrentDirectory(destination.data);
   if (!result) {
     printf("Error setting cwd: %lu\n", GetLastError());
   }
-  GetCwd();
+  cachedCwd = (String){0};
 }
 
 Folder *GetDirFiles(String initial) {
@@ -44,11 +50,7 @@ Folder *GetDirFiles(String initial) {
       continue;
     }
 
-    if (folder->totalCount >= MAX_FILES) {
-      LogError("Warning: Maximum file count reached (%d). Some files might be skipped.\n", MAX_FILES);
-      abort();
-    }
-
+    FolderReserve(folder);
     bool isDirectory = findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY;
     File *currFile = &folder->files[folder->fileCount];
     Folder *currFolder = &folder->folders[folder->folderCount];
@@ -61,14 +63,13 @@ Folder *GetDirFiles(String initial) {
     if (!isDirectory) {
       char *dot = strrchr(findData.cFileName, '.');
       if (dot != NULL) {
-        currFile->extension = strdup(dot + 1);
-;
-        currFile->name = s(strdup(findData.cFileName));
+        currFile->extension = StrNew(dot + 1).data;
+        currFile->name = StrNew(findData.cFileName);
       }
 
       if (dot == NULL) {
-        currFile->extension = strdup("");
-        currFile->name = s(strdup(findData.cFileName));
+        currFile->extension = StrNew("").data;
+        currFile->name = StrNew(findData.cFileName);
       }
 
       LARGE_INTEGER createTime, modifyTime;
@@ -126,13 +127,13 @@ errno_t FileStats(String *path, File *result) {
     nameStart = pathStr;
   }
 
-  result->name = s(strdup(nameStart));
+  result->name = StrNew(nameStart);
 
   char *extStart = strrchr(nameStart, '.');
   if (extStart) {
-    result->extension = strdup(extStart + 1);
+    result->extension = StrNew(extStart + 1).data;
   } else {
-    result->extension = strdup("");
+    result->extension = StrNew("").data;
   }
 
   LARGE_INTEGER fileSize;
@@ -155,6 +156,34 @@ errno_t FileStats(String *path, File *result) {
   return SUCCESS;
 }
 
+errno_t FileModifyTime(String *path, i64 *modifyTime) {
+  WIN32_FILE_ATTRIBUTE_DATA fileAttr = {0};
+
+  if (!GetFileAttributesExA(path->data, GetFileExInfoStandard, &fileAttr)) {
+    DWORD error = GetLastError();
+    if (error == ERROR_FILE_NOT_FOUND || error == ERROR_PATH_NOT_FOUND) {
+      return FILE_NOT_EXIST;
+    }
+    LogError("Failed to get file attributes: %lu", error);
+    return FILE_GET_ATTRIBUTES_FAILED;
+  }
+
+  LARGE_INTEGER writeTime;
+  writeTime.LowPart = fileAttr.ftLastWriteTime.dwLowDateTime;
+  writeTime.HighPart = fileAttr.ftLastWriteTime.dwHighDateTime;
+
+  const i64 UNIX_EPOCH_TICKS = 116444736000000000LL;
+  *modifyTime = (writeTime.QuadPart - UNIX_EPOCH_TICKS) * 100;
+  return SUCCESS;
+}
+
+errno_t FileTouch(String *path) {
+  if (_utime(path->data, NULL) != 0) {
+    return FILE_GET_ATTRIBUTES_FAILED;
+  }
+  return SUCCESS;
+}
+
 errno_t FileRead(String *path, String *result) {
   HANDLE hFile = INVALID_HANDLE_VALUE;
 
@@ -188,7 +217,7 @@ errno_t FileRead(String *path, String *result) {
     return FILE_GET_SIZE_FAILED;
   }
 
-  char *buffer = (char *)malloc(fileSize.QuadPart);
+  char *buffer = (char *)malloc(fileSize.QuadPart + 1);
   if (!buffer) {
     LogError("Memory allocation failed");
     CloseHandle(hFile);
@@ -200,11 +229,14 @@ errno_t FileRead(String *path, String *result) {
   if (!ReadFile(hFile, buffer, (DWORD)fileSize.QuadPart, &bytesRead, NULL) || bytesRead != fileSize.QuadPart) {
     LogError("Failed to read file: %lu", GetLastError());
     CloseHandle(hFile);
+    free(buffer);
     free(pathStr);
     return FILE_READ_FAILED;
   }
 
-  *result = StrNewSize(buffer, (size_t)bytesRead);
+  // NOTE: The buffer is the result, callers give it back with FileFreeContent even while an arena is set
+  buffer[bytesRead] = '\0';
+  *result = (String){(size_t)bytesRead, buffer};
 
   CloseHandle(hFile);
   free(pathStr);
@@ -0,0 +1,136 @@
+#ifndef BASE_H
+# include "core/base.h"
+#endif
+
+#ifdef PLATFORM_WIN
+
+#include <windows.h>
+#include <psapi.h>
+
+errno_t ProcessSpawn(String command, Process *process) {
+  STARTUPINFOA startupInfo = {0};
+  PROCESS_INFORMATION processInfo = {0};
+  startupInfo.cb = sizeof(startupInfo);
+
+  String commandLine = FormatMalloc("cmd.exe /c %s", command.data);
+  bool result = CreateProcessA(NULL, commandLine.data, NULL, NULL, true, 0, NULL, NULL, &startupInfo, &processInfo);
+  StrFree(commandLine);
+
+  if (!result) {
+    LogError("Couldn't create process for command %s, %lu", command.data, GetLastError());
+    return PROCESS_SPAWN_FAILED;
+  }
+
+  CloseHandle(processInfo.hThread);
+  process->handle = (i64)processInfo.hProcess;
+  process->exitCode = 0;
+  return SUCCESS;
+}
+
+void ProcessReapFinished() {
+}
+
+StringVector ProcessArguments() {
+  StringVector result = {0};
+  for (i32 i = 0; i < __argc; i++) {
+    VecPush(result, s(__argv[i]));
+  }
+  return result;
+}
+
+// NOTE: WaitForMultipleObjects takes at most MAXIMUM_WAIT_OBJECTS handles, larger sets are polled in batches of that size
+static DWORD processWaitBatches(HANDLE *handles, size_t count) {
+  if (count <= MAXIMUM_WAIT_OBJECTS) {
+    DWORD result = WaitForMultipleObjects((DWORD)count, handles, false, INFINITE);
+    return result < WAIT_OBJECT_0 + count ? result - WAIT_OBJECT_0 : WAIT_FAILED;
+  }
+
+  while (true) {
+    for (size_t start = 0; start < count; start += MAXIMUM_WAIT_OBJECTS) {
+      size_t batch = count - start < MAXIMUM_WAIT_OBJECTS ? count - start : MAXIMUM_WAIT_OBJECTS;
+      DWORD result = WaitForMultipleObjects((DWORD)batch, handles + start, false, start == 0 ? 10 : 0);
+      if (result < WAIT_OBJECT_0 + batch) {
+        return (DWORD)start + result - WAIT_OBJECT_0;
+      }
+      if (result != WAIT_TIMEOUT) {
+        return WAIT_FAILED;
+      }
+    }
+  }
+}
+
+errno_t ProcessWait(Process *processes, size_t count, size_t *finished) {
+  HANDLE *handles = malloc(sizeof(HANDLE) * count);
+  for (size_t i = 0; i < count; i++) {
+    handles[i] = (HANDLE)processes[i].handle;
+  }
+
+  DWORD result = processWaitBatches(handles, count);
+  free(handles);
+  if (result == WAIT_FAILED) {
+    LogError("Couldn't wait for child processes, %lu", GetLastError());
+    return PROCESS_WAIT_FAILED;
+  }
+
+  size_t index = result;
+  HANDLE handle = (HANDLE)processes[index].handle;
+  DWORD exitCode = 0;
+  GetExitCodeProcess(handle, &exitCode);
+
+  FILETIME creation, exited, kernel, user;
+  PROCESS_MEMORY_COUNTERS memory = {0};
+  i64 cpuTime = 0;
+  if (GetProcessTimes(handle, &creation, &exited, &kernel, &user)) {
+    u64 kernelTime = ((u64)kernel.dwHighDateTime << 32) | kernel.dwLowDateTime;
+    u64 userTime = ((u64)user.dwHighDateTime << 32) | user.dwLowDateTime;
+    cpuTime = (i64)((kernelTime + userTime) / 10); // NOTE: FILETIME counts 100ns ticks
+  }
+  K32GetProcessMemoryInfo(handle, &memory, sizeof(memory));
+  CloseHandle(handle);
+
+  processes[index].exitCode = (i32)exitCode;
+  processes[index].cpuTime = cpuTime;
+  processes[index].peakMemory = (i64)(memory.PeakWorkingSetSize / 1024);
+  *finished = index;
+  return SUCCESS;
+}
+
+errno_t ProcessRestart(String exe) {
+  char *arguments = GetCommandLineA();
+  if (*arguments == '"') {
+    arguments = strchr(arguments + 1, '"');
+    arguments = arguments == NULL ? "" : arguments + 1;
+  } else {
+    while (*arguments != '\0' && *arguments != ' ') {
+      arguments++;
+    }
+  }
+
+  Process process;
+  String command = FormatMalloc("\"%s\"%s", exe.data, arguments);
+  errno_t err = ProcessSpawn(command, &process);
+  StrFree(command);
+  if (err != SUCCESS) {
+    return err;
+  }
+
+  size_t finished;
+  err = ProcessWait(&process, 1, &finished);
+  if (err != SUCCESS) {
+    return err;
+  }
+  exit(process.exitCode);
+}
+
+i32 ProcessorCount() {
+  SYSTEM_INFO systemInfo;
+  GetSystemInfo(&systemInfo);
+  return systemInfo.dwNumberOfProcessors > 0 ? (i32)systemInfo.dwNumberOfProcessors : 1;
+}
+
+bool FindExecutable(String name) {
+  char candidate[MAX_PATH];
+  return SearchPathA(NULL, name.data, ".exe", MAX_PATH, candidate, NULL) != 0;
+}
+
+#endif
@@ -19,6 +19,20 @@ i64 TimeNow() {
   return currentTime;
 }
 
+i64 TimeNanoseconds() {
+  static LARGE_INTEGER frequency = {0};
+  if (frequency.QuadPart == 0) {
+    QueryPerformanceFrequency(&frequency);
+  }
+
+  LARGE_INTEGER counter;
+  QueryPerformanceCounter(&counter);
+  // NOTE: Split up so the multiplication doesn't overflow
+  i64 seconds = counter.QuadPart / frequency.QuadPart;
+  i64 remainder = counter.QuadPart % frequency.QuadPart;
+  return seconds * 1000000000LL + remainder * 1000000000LL / frequency.QuadPart;
+}
+
 void WaitTime(i64 ms) {
   Sleep(ms);
 }